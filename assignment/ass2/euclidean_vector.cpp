@@ -3,24 +3,568 @@
 //
 #include "comp6771/euclidean_vector.hpp"
 
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <exception>
+#include <numbers>
+#include <thread>
+
 namespace comp6771 {
-	// Implement solution here
-	// test line
+	namespace {
+		// batched dot is computed in 4 x 4 register tiles
+		constexpr auto dot_tile = std::size_t{4};
+		// ys are processed in blocks of about 256KB so a block stays in L2
+		// while every tile of xs is streamed against it
+		constexpr auto dot_block_bytes = std::size_t{256} * 1024;
+
+		// 4 x 4 tile of dot products
+		// each of the 16 sums is accumulated in the same order as std::inner_product
+		// so the result is identical to the scalar dot of vectors below parallel_threshold
+		auto dot_kernel_4x4(double const* const* xs,
+		                    double const* const* ys,
+		                    std::size_t length,
+		                    double* out,
+		                    std::size_t out_stride) -> void {
+			double acc[dot_tile][dot_tile] = {}; // NOLINT(modernize-avoid-c-arrays)
+			for (auto k = std::size_t{0}; k < length; ++k) {
+				auto const x0 = xs[0][k];
+				auto const x1 = xs[1][k];
+				auto const x2 = xs[2][k];
+				auto const x3 = xs[3][k];
+				for (auto j = std::size_t{0}; j < dot_tile; ++j) {
+					auto const y = ys[j][k];
+					acc[0][j] += x0 * y;
+					acc[1][j] += x1 * y;
+					acc[2][j] += x2 * y;
+					acc[3][j] += x3 * y;
+				}
+			}
+			for (auto i = std::size_t{0}; i < dot_tile; ++i) {
+				std::copy_n(acc[i], dot_tile, out + i * out_stride);
+			}
+		}
+
+		// vectors with at least this many components are processed in parallel
+		constexpr auto parallel_threshold = std::size_t{1} << 20U;
+		// chunks have a fixed size so partial sums are always combined in the same
+		// order, whatever the number of threads
+		constexpr auto parallel_chunk = std::size_t{1} << 16U;
+
+		// calls f(i) for every i in [0, count), spread over the hardware threads
+		// if a thread cannot be started the calling thread does the remaining work,
+		// so this never throws and is safe to call from noexcept functions
+		template<typename F>
+		auto parallel_for(std::size_t count, F f) -> void {
+			auto const threads =
+			   std::min(static_cast<std::size_t>(std::thread::hardware_concurrency()), count);
+			if (threads <= 1) {
+				for (auto i = std::size_t{0}; i < count; ++i) {
+					f(i);
+				}
+				return;
+			}
+			auto next = std::atomic<std::size_t>{0};
+			auto worker = [&next, &f, count] {
+				for (auto i = next++; i < count; i = next++) {
+					f(i);
+				}
+			};
+			// jthreads join when the pool goes out of scope
+			auto pool = std::vector<std::jthread>();
+			try {
+				pool.reserve(threads - 1);
+				for (auto t = std::size_t{1}; t < threads; ++t) {
+					pool.emplace_back(worker);
+				}
+			}
+			catch (std::exception const&) {
+				// std::system_error from the thread or std::bad_alloc from the pool,
+				// the threads already running and this one share the work
+			}
+			worker();
+		}
+
+		// calls f(first, last) on chunks of [0, length)
+		// small vectors are a single chunk on the calling thread
+		template<typename F>
+		auto for_each_chunk(std::size_t length, F f) -> void {
+			if (length < parallel_threshold) {
+				f(std::size_t{0}, length);
+				return;
+			}
+			auto const chunks = (length + parallel_chunk - 1) / parallel_chunk;
+			parallel_for(chunks, [&f, length](std::size_t c) {
+				f(c * parallel_chunk, std::min((c + 1) * parallel_chunk, length));
+			});
+		}
+
+		// sum of f(first, last) over the chunks of [0, length)
+		// partial sums are added in chunk order so the result is reproducible
+		template<typename F>
+		auto chunked_sum(std::size_t length, F f) -> double {
+			if (length < parallel_threshold) {
+				return f(std::size_t{0}, length);
+			}
+			auto const chunks = (length + parallel_chunk - 1) / parallel_chunk;
+			auto partials = std::vector<double>(chunks);
+			parallel_for(chunks, [&f, &partials, length](std::size_t c) {
+				partials[c] = f(c * parallel_chunk, std::min((c + 1) * parallel_chunk, length));
+			});
+			return std::accumulate(partials.begin(), partials.end(), 0.0);
+		}
+
+		// a * b + c as a single fused instruction when the target has one
+		// (std::fma without hardware support is a slow library call)
+		inline auto multiply_add(double a, double b, double c) noexcept -> double {
+#ifdef FP_FAST_FMA
+			return std::fma(a, b, c);
+#else
+			return a * b + c;
+#endif
+		}
+
+		// kmeans_step assigns points in blocks this long, one block per task
+		constexpr auto kmeans_block = std::size_t{256};
+
+		// dot of x and y accumulated with Neumaier compensation in index order
+		// each product's rounding error is recovered exactly with an fma
+		auto compensated_dot(double const* x, double const* y, std::size_t length) noexcept
+		   -> double {
+			auto sum = 0.0;
+			auto compensation = 0.0;
+			for (auto i = std::size_t{0}; i < length; ++i) {
+				auto const product = x[i] * y[i];
+				auto const product_error = std::fma(x[i], y[i], -product);
+				auto const t = sum + product;
+				if (std::abs(sum) >= std::abs(product)) {
+					compensation += (sum - t) + product;
+				}
+				else {
+					compensation += (product - t) + sum;
+				}
+				compensation += product_error;
+				sum = t;
+			}
+			return sum + compensation;
+		}
+
+#ifndef __SIZEOF_INT128__
+#error "fixed_point_vector needs __int128, use GCC or Clang on a 64-bit target"
+#endif
+		__extension__ using fixed_point_sum = __int128;
+
+		// exact dot of two fixed_point_vector buffers
+		// integer addition is associative, so the chunks can be summed in any order
+		auto fixed_point_dot(std::int64_t const* x, std::int64_t const* y, std::size_t length)
+		   -> fixed_point_sum {
+			auto const partial = [x, y](std::size_t first, std::size_t last) {
+				auto sum = fixed_point_sum{0};
+				for (auto i = first; i < last; ++i) {
+					sum += static_cast<fixed_point_sum>(x[i]) * y[i];
+				}
+				return sum;
+			};
+			if (length < parallel_threshold) {
+				return partial(0, length);
+			}
+			auto const chunks = (length + parallel_chunk - 1) / parallel_chunk;
+			auto partials = std::vector<fixed_point_sum>(chunks);
+			parallel_for(chunks, [&partial, &partials, length](std::size_t c) {
+				partials[c] = partial(c * parallel_chunk, std::min((c + 1) * parallel_chunk, length));
+			});
+			return std::accumulate(partials.begin(), partials.end(), fixed_point_sum{0});
+		}
+
+		// the largest magnitude a fixed_point_vector component may hold, in units
+		constexpr auto fixed_point_limit = std::int64_t{1} << static_cast<unsigned>(
+		                                      fixed_point_vector::fraction_bits
+		                                      + fixed_point_vector::integer_bits);
+
+		auto in_fixed_point_range(std::int64_t n) noexcept -> bool {
+			return n > -fixed_point_limit and n < fixed_point_limit;
+		}
+
+		// lhs[i] = op(lhs[i], rhs[i]), or throws and leaves lhs unchanged if any result
+		// is out of range
+		// every result is checked before the first one is written, so no copy is needed
+		// both sides are below the limit, so op cannot overflow int64
+		template<typename Op>
+		auto combine_fixed_point(std::vector<std::int64_t>& lhs,
+		                         std::vector<std::int64_t> const& rhs,
+		                         Op op) -> void {
+			for (auto i = std::size_t{0}; i < lhs.size(); ++i) {
+				if (not in_fixed_point_range(op(lhs[i], rhs[i]))) {
+					throw euclidean_vector_error("fixed_point_vector component out of range");
+				}
+			}
+			std::transform(lhs.begin(), lhs.end(), rhs.begin(), lhs.begin(), op);
+		}
+
+		// euclidean_matrix products hand out this many rows per task
+		constexpr auto matrix_band = std::size_t{64};
+
+		// calls band(first, last) on consecutive bands of [0, count), in parallel
+		// when the whole product does at least parallel_threshold multiply-adds
+		template<typename F>
+		auto for_each_band(std::size_t count, std::size_t band_size, std::size_t work, F band)
+		   -> void {
+			auto const bands = (count + band_size - 1) / band_size;
+			auto const run = [&band, count, band_size](std::size_t b) {
+				band(b * band_size, std::min((b + 1) * band_size, count));
+			};
+			if (work < parallel_threshold) {
+				for (auto b = std::size_t{0}; b < bands; ++b) {
+					run(b);
+				}
+			}
+			else {
+				parallel_for(bands, run);
+			}
+		}
+
+		// linear_combination works on blocks this long, 8KB of output
+		constexpr auto combination_block = std::size_t{1024};
+
+		// dot product of two raw rows
+		// four independent sums let the compiler keep several vector lanes busy
+		auto row_dot(double const* x, double const* y, std::size_t length) noexcept -> double {
+			auto s0 = 0.0;
+			auto s1 = 0.0;
+			auto s2 = 0.0;
+			auto s3 = 0.0;
+			auto k = std::size_t{0};
+			for (; k + 4 <= length; k += 4) {
+				s0 += x[k] * y[k];
+				s1 += x[k + 1] * y[k + 1];
+				s2 += x[k + 2] * y[k + 2];
+				s3 += x[k + 3] * y[k + 3];
+			}
+			for (; k < length; ++k) {
+				s0 += x[k] * y[k];
+			}
+			return (s0 + s1) + (s2 + s3);
+		}
+
+		// the two halves of a Lloyd's k-means iteration on raw rows, shared by
+		// kmeans_step and knn_index::build_ivf
+		// point(i) and centroid(c) return rows of length doubles
+
+		// assignment step, points go to the centroid minimising |c|^2 - 2x.c
+		// (|x|^2 is the same for every c), ties go to the lowest index
+		// returns how many points changed cluster
+		template<typename Point, typename Centroid>
+		auto assign_to_nearest(std::size_t points,
+		                       Point point,
+		                       Centroid centroid,
+		                       std::span<double const> centroid_squared_norms,
+		                       std::size_t length,
+		                       std::span<std::size_t> assignment) -> std::size_t {
+			auto const k = centroid_squared_norms.size();
+			auto changed = std::atomic<std::size_t>{0};
+			auto const assign_block = [&](std::size_t block) {
+				auto block_changed = std::size_t{0};
+				auto const last = std::min((block + 1) * kmeans_block, points);
+				for (auto i = block * kmeans_block; i < last; ++i) {
+					auto const x = point(i);
+					auto best = std::numeric_limits<double>::infinity();
+					auto nearest = std::size_t{0};
+					for (auto c = std::size_t{0}; c < k; ++c) {
+						auto const d = centroid_squared_norms[c] - 2.0 * row_dot(x, centroid(c), length);
+						if (d < best) {
+							best = d;
+							nearest = c;
+						}
+					}
+					if (assignment[i] != nearest) {
+						assignment[i] = nearest;
+						++block_changed;
+					}
+				}
+				changed += block_changed;
+			};
+			auto const blocks = (points + kmeans_block - 1) / kmeans_block;
+			if (points * k * length < parallel_threshold) {
+				for (auto block = std::size_t{0}; block < blocks; ++block) {
+					assign_block(block);
+				}
+			}
+			else {
+				parallel_for(blocks, assign_block);
+			}
+			return changed.load();
+		}
+
+		// update step, each centroid with points moves to their mean, the sums are
+		// built in the centroids' own storage in point order so the result does
+		// not depend on the thread count
+		// returns the number of points per centroid, a centroid with none is unchanged
+		template<typename Point, typename Centroid>
+		auto move_to_means(std::size_t points,
+		                   Point point,
+		                   std::size_t k,
+		                   Centroid centroid,
+		                   std::size_t length,
+		                   std::span<std::size_t const> assignment) -> std::vector<std::size_t> {
+			auto counts = std::vector<std::size_t>(k);
+			for (auto const a : assignment) {
+				++counts[a];
+			}
+			for (auto c = std::size_t{0}; c < k; ++c) {
+				if (counts[c] != 0) {
+					std::fill_n(centroid(c), length, 0.0);
+				}
+			}
+			for (auto i = std::size_t{0}; i < points; ++i) {
+				detail::add(centroid(assignment[i]), point(i), length);
+			}
+			for (auto c = std::size_t{0}; c < k; ++c) {
+				if (counts[c] != 0) {
+					detail::divide(centroid(c), static_cast<double>(counts[c]), length);
+				}
+			}
+			return counts;
+		}
+
+		// splitmix64 finaliser, spreads every input bit over the whole word
+		constexpr auto mix(std::uint64_t x) noexcept -> std::uint64_t {
+			x = (x ^ (x >> 30U)) * 0xbf58476d1ce4e5b9U;
+			x = (x ^ (x >> 27U)) * 0x94d049bb133111ebU;
+			return x ^ (x >> 31U);
+		}
+
+		// hash_value mixes this many components per step
+		constexpr auto hash_lanes = std::size_t{4};
+
+		auto nearer(knn_index::neighbour const& a, knn_index::neighbour const& b) noexcept -> bool {
+			if (a.distance != b.distance) {
+				return a.distance < b.distance;
+			}
+			return a.index < b.index;
+		}
+
+		// bfloat16 keeps the top 16 bits of a float, rounded to nearest even
+		auto to_bfloat16(float value) noexcept -> std::uint16_t {
+			auto const bits = std::bit_cast<std::uint32_t>(value);
+			if (std::isnan(value)) {
+				return static_cast<std::uint16_t>((bits >> 16U) | 0x40U);
+			}
+			auto const rounding = 0x7FFFU + ((bits >> 16U) & 1U);
+			return static_cast<std::uint16_t>((bits + rounding) >> 16U);
+		}
+
+		auto from_bfloat16(std::uint16_t value) noexcept -> double {
+			return static_cast<double>(std::bit_cast<float>(static_cast<std::uint32_t>(value) << 16U));
+		}
+
+		auto byteswap(std::uint64_t value) noexcept -> std::uint64_t {
+			auto result = std::uint64_t{0};
+			for (auto i = 0; i < 8; ++i) {
+				result = (result << 8U) | (value & 0xFFU);
+				value >>= 8U;
+			}
+			return result;
+		}
+
+		// converts between host and little-endian byte order, in place
+		auto to_little_endian(std::uint64_t* first, std::size_t length) noexcept -> void {
+			if constexpr (std::endian::native != std::endian::little) {
+				std::transform(first, first + length, first, byteswap);
+			}
+		}
+
+		// printf("%g") formatting, which is what the default ostream formatting
+		// of a double produces
+		constexpr auto text_precision = 6;
+		// enough for "-1.23457e-308" and a separator
+		constexpr auto max_component_chars = std::size_t{16};
+
+		auto format_component(char* first, char* last, double value) -> std::to_chars_result {
+			return std::to_chars(first, last, value, std::chars_format::general, text_precision);
+		}
+
+		auto parse_error() -> euclidean_vector_error {
+			return euclidean_vector_error("Invalid euclidean_vector text");
+		}
+
+		auto skip_spaces(char const* first, char const* last) noexcept -> char const* {
+			return std::find_if(first, last, [](char c) { return c != ' '; });
+		}
+
+		// calls f(value) for every component of "[a b c]"
+		template<typename F>
+		auto parse_components(std::string_view text, F f) -> void {
+			auto const last = text.data() + text.size();
+			auto p = skip_spaces(text.data(), last);
+			if (p == last or *p != '[') {
+				throw parse_error();
+			}
+			p = skip_spaces(p + 1, last);
+			while (p != last and *p != ']') {
+				auto value = 0.0;
+				auto const [end, error] = std::from_chars(p, last, value);
+				if (error != std::errc{} or (end != last and *end != ' ' and *end != ']')) {
+					throw parse_error();
+				}
+				f(value);
+				p = skip_spaces(end, last);
+			}
+			if (p == last or skip_spaces(p + 1, last) != last) {
+				throw parse_error();
+			}
+		}
+
+		auto truncated_error() -> euclidean_vector_error {
+			return euclidean_vector_error("Truncated euclidean_vector in binary input");
+		}
+
+		auto corrupt_header_error() -> euclidean_vector_error {
+			return euclidean_vector_error("Corrupt euclidean_vector dimension in binary input");
+		}
+
+		// a dimension must fit dimensions()'s int
+		auto valid_header(std::uint64_t header) noexcept -> bool {
+			return header <= static_cast<std::uint64_t>(std::numeric_limits<int>::max());
+		}
+
+		// bytes left in is, or -1 if it cannot seek
+		auto remaining_bytes(std::istream& is) -> std::streamoff {
+			auto const position = is.tellg();
+			if (position == std::streampos(-1)) {
+				return -1;
+			}
+			auto const state = is.rdstate();
+			is.seekg(0, std::ios::end);
+			auto const end = is.tellg();
+			is.clear(state);
+			is.seekg(position);
+			return end == std::streampos(-1) ? -1 : end - position;
+		}
+	} // namespace
+
+	namespace detail {
+		auto add(double* x, double const* y, std::size_t length) -> void {
+			for_each_chunk(length, [x, y](std::size_t first, std::size_t last) {
+				std::transform(y + first, y + last, x + first, x + first, std::plus<>());
+			});
+		}
+
+		auto subtract(double* x, double const* y, std::size_t length) -> void {
+			for_each_chunk(length, [x, y](std::size_t first, std::size_t last) {
+				std::transform(x + first, x + last, y + first, x + first, std::minus<>());
+			});
+		}
+
+		auto multiply(double* x, double scalar, std::size_t length) -> void {
+			for_each_chunk(length, [x, scalar](std::size_t first, std::size_t last) {
+				std::transform(x + first, x + last, x + first, [scalar](double n) { return n * scalar; });
+			});
+		}
+
+		auto divide(double* x, double divisor, std::size_t length) -> void {
+			for_each_chunk(length, [x, divisor](std::size_t first, std::size_t last) {
+				std::transform(x + first, x + last, x + first, [divisor](double n) {
+					return n / divisor;
+				});
+			});
+		}
+
+		auto axpby(double alpha, double const* x, double beta, double* y, std::size_t length) -> void {
+			for_each_chunk(length, [alpha, x, beta, y](std::size_t first, std::size_t last) {
+				if (beta == 1.0) {
+					for (auto i = first; i < last; ++i) {
+						y[i] = multiply_add(alpha, x[i], y[i]);
+					}
+				}
+				else if (alpha == 1.0) {
+					for (auto i = first; i < last; ++i) {
+						y[i] = multiply_add(beta, y[i], x[i]);
+					}
+				}
+				else {
+					for (auto i = first; i < last; ++i) {
+						y[i] = multiply_add(alpha, x[i], beta * y[i]);
+					}
+				}
+			});
+		}
+
+		auto dot(double const* x, double const* y, std::size_t length) -> double {
+			return chunked_sum(length, [x, y](std::size_t first, std::size_t last) {
+				return std::inner_product(x + first, x + last, y + first, 0.0);
+			});
+		}
+
+		auto squared_norm(double const* x, std::size_t length) -> double {
+			return chunked_sum(length, [x](std::size_t first, std::size_t last) {
+				auto partial = 0.0;
+				std::for_each (x + first, x + last, [&partial](auto const n) { partial += n * n; });
+				return partial;
+			});
+		}
+
+		// the throw helpers are kept out of line so the checks that call them stay small
+		auto throw_dimension_error(std::size_t x, std::size_t y) -> void {
+			std::stringstream error_stream;
+			error_stream << "Dimensions of LHS(";
+			error_stream << x;
+			error_stream << ") and RHS(";
+			error_stream << y;
+			error_stream << ") do not match";
+			throw euclidean_vector_error(error_stream.str());
+		}
+
+		auto throw_index_error(int index) -> void {
+			std::stringstream error_stream;
+			error_stream << "Index ";
+			error_stream << index;
+			error_stream << " is not valid for this euclidean_vector object";
+			throw euclidean_vector_error(error_stream.str());
+		}
+
+		auto throw_division_by_zero() -> void {
+			throw euclidean_vector_error("Invalid vector division by 0");
+		}
+	} // namespace detail
+
+	euclidean_vector::euclidean_vector(const_euclidean_vector_view view, allocator_type allocator) {
+		dimension_ = static_cast<size_t>(view.dimensions());
+		reset_norm();
+		magnitude_ = allocate(dimension_, allocator);
+		std::copy(view.data(), view.data() + dimension_, magnitude_.get());
+	}
+
 
 	// copy assignment
-	auto euclidean_vector::operator=(euclidean_vector const& orig) noexcept -> euclidean_vector& {
-		auto copy(orig);
-		copy.swap(*this);
+	// when the current buffer is large enough the components are copied in place,
+	// so reassigning same sized vectors in a loop never allocates
+	// otherwise a new buffer comes from this vector's resource, which stays with it
+	auto euclidean_vector::operator=(euclidean_vector const& orig) -> euclidean_vector& {
+		if (this == &orig) {
+			return *this;
+		}
+		if (orig.dimension_ > capacity()) {
+			auto copy = euclidean_vector(orig, get_allocator());
+			copy.swap(*this);
+			return *this;
+		}
+		dimension_ = orig.dimension_;
+		copy_norm(orig);
+		std::copy(orig.magnitude_.get(), orig.magnitude_.get() + orig.dimension_, magnitude_.get());
 		return *this;
 	}
 
 	// move assignment
-	// I create a copy and swap this with copy
-	// copy will be freed once exit
+	// the buffer is taken over directly and the old one is freed,
+	// orig is left with dimension 0 like a moved from vector
 	auto euclidean_vector::operator=(euclidean_vector&& orig) noexcept -> euclidean_vector& {
-		// this is move constructor
-		auto copy = euclidean_vector(std::move(orig));
-		copy.swap(*this);
+		if (this == &orig) {
+			return *this;
+		}
+		magnitude_ = take_buffer(orig.magnitude_);
+		dimension_ = std::exchange(orig.dimension_, 0);
+		copy_norm(orig);
+		orig.reset_norm();
 		return *this;
 	}
 
@@ -38,107 +582,113 @@ namespace comp6771 {
 	}
 
 	// Unary plus
-	auto euclidean_vector::operator+() const noexcept -> euclidean_vector {
+	auto euclidean_vector::operator+() const -> euclidean_vector {
 		auto copy = euclidean_vector(*this);
 		return copy;
 	}
 
 	// Negation
-	auto euclidean_vector::operator-() const noexcept -> euclidean_vector {
+	auto euclidean_vector::operator-() const -> euclidean_vector {
 		auto copy = euclidean_vector(*this);
-		std::transform(copy.magnitude_.get(),
-		               copy.magnitude_.get() + copy.dimension_,
-		               copy.magnitude_.get(),
-		               [](double n) { return -n; });
+		auto const data = copy.magnitude_.get();
+		for_each_chunk(copy.dimension_, [data](std::size_t first, std::size_t last) {
+			std::transform(data + first, data + last, data + first, [](double n) { return -n; });
+		});
 		return copy;
 	}
 
 	// Compound Addition
 	auto euclidean_vector::operator+=(euclidean_vector const& rhs) -> euclidean_vector& {
 		if (rhs.dimension_ != this->dimension_) {
-			auto x = this->dimension_;
-			auto y = rhs.dimension_;
-			std::stringstream error_stream;
-			error_stream << "Dimensions of LHS(";
-			error_stream << x;
-			error_stream << ") and RHS(";
-			error_stream << y;
-			error_stream << ") do not match";
-			throw euclidean_vector_error(error_stream.str());
+			detail::throw_dimension_error(this->dimension_, rhs.dimension_);
 		}
 		reset_norm();
-		std::transform(rhs.magnitude_.get(),
-		               rhs.magnitude_.get() + rhs.dimension_,
-		               magnitude_.get(),
-		               magnitude_.get(),
-		               std::plus<>());
+		detail::add(magnitude_.get(), rhs.magnitude_.get(), dimension_);
 		return *this;
 	}
 	// Compound Substraction
 	auto euclidean_vector::operator-=(euclidean_vector const& rhs) -> euclidean_vector& {
 		if (rhs.dimension_ != this->dimension_) {
-			auto x = this->dimension_;
-			auto y = rhs.dimension_;
-			std::stringstream error_stream;
-			error_stream << "Dimensions of LHS(";
-			error_stream << x;
-			error_stream << ") and RHS(";
-			error_stream << y;
-			error_stream << ") do not match";
-			throw euclidean_vector_error(error_stream.str());
+			detail::throw_dimension_error(this->dimension_, rhs.dimension_);
 		}
 		reset_norm();
-		std::transform(magnitude_.get(),
-		               magnitude_.get() + dimension_,
-		               rhs.magnitude_.get(),
-		               magnitude_.get(),
-		               std::minus<>());
+		detail::subtract(magnitude_.get(), rhs.magnitude_.get(), dimension_);
 		return *this;
 	}
 	// Compound Multiplication
 	auto euclidean_vector::operator*=(double scalar) noexcept -> euclidean_vector& {
-		std::transform(magnitude_.get(),
-		               magnitude_.get() + dimension_,
-		               magnitude_.get(),
-		               [scalar](double& n) { return n * scalar; });
+		detail::multiply(magnitude_.get(), scalar, dimension_);
 		reset_norm();
 		return *this;
 	}
 	// Compound Devision
 	auto euclidean_vector::operator/=(double dividend) -> euclidean_vector& {
 		if (dividend == 0.0) {
-			throw euclidean_vector_error("Invalid vector division by 0");
+			detail::throw_division_by_zero();
 		}
 		reset_norm();
-		std::transform(magnitude_.get(),
-		               magnitude_.get() + dimension_,
-		               magnitude_.get(),
-		               [dividend](double& n) { return n / dividend; });
+		detail::divide(magnitude_.get(), dividend, dimension_);
 		return *this;
 	}
 
+	auto euclidean_vector::axpy(double alpha, const_euclidean_vector_view x) -> euclidean_vector& {
+		return axpby(alpha, x, 1.0);
+	}
+
+	auto euclidean_vector::axpby(double alpha, const_euclidean_vector_view x, double beta)
+	   -> euclidean_vector& {
+		if (static_cast<std::size_t>(x.dimensions()) != dimension_) {
+			detail::throw_dimension_error(dimension_, static_cast<std::size_t>(x.dimensions()));
+		}
+		reset_norm();
+		detail::axpby(alpha, x.data(), beta, magnitude_.get(), dimension_);
+		return *this;
+	}
+
+	auto euclidean_vector::scale_add(double beta, const_euclidean_vector_view x) -> euclidean_vector& {
+		return axpby(1.0, x, beta);
+	}
+
 	// std::vector type conversion
+	// the vector is sized once from the range instead of growing per element
 	euclidean_vector::operator std::vector<double>() const noexcept {
-		std::vector<double> vec;
-		std::copy(magnitude_.get(), magnitude_.get() + dimension_, back_inserter(vec));
-		return vec;
+		return std::vector<double>(magnitude_.get(), magnitude_.get() + dimension_);
 	}
 
 	// std::list type conversion
+	// a list still needs one node per component
 	euclidean_vector::operator std::list<double>() const noexcept {
-		std::list<double> l;
-		std::copy(magnitude_.get(), magnitude_.get() + dimension_, back_inserter(l));
-		return l;
+		return std::list<double>(magnitude_.get(), magnitude_.get() + dimension_);
+	}
+
+	auto euclidean_vector::copy_to(std::span<double> out) const -> void {
+		if (out.size() != dimension_) {
+			detail::throw_dimension_error(dimension_, out.size());
+		}
+		std::copy(magnitude_.get(), magnitude_.get() + dimension_, out.begin());
+	}
+
+	auto euclidean_vector::assign(std::span<double const> values) -> euclidean_vector& {
+		// a moved from vector has no buffer to reuse
+		if (magnitude_ == nullptr or values.size() > capacity()) {
+			magnitude_ = allocate(values.size(), get_allocator());
+		}
+		dimension_ = values.size();
+		reset_norm();
+		std::copy(values.begin(), values.end(), magnitude_.get());
+		return *this;
+	}
+
+	auto euclidean_vector::release() && noexcept -> buffer_type {
+		dimension_ = 0;
+		reset_norm();
+		return take_buffer(magnitude_);
 	}
 
 	// member function at with copy
 	[[nodiscard]] auto euclidean_vector::at(int index) const -> double {
 		if (index < 0 or index >= static_cast<int>(dimension_)) {
-			std::stringstream error_stream;
-			error_stream << "Index ";
-			error_stream << index;
-			error_stream << " is not valid for this euclidean_vector object";
-			throw euclidean_vector_error(error_stream.str());
+			detail::throw_index_error(index);
 		}
 		return magnitude_[static_cast<size_t>(index)];
 	}
@@ -146,32 +696,64 @@ namespace comp6771 {
 	// member function at with reference
 	[[nodiscard]] auto euclidean_vector::at(int index) -> double& {
 		if (index < 0 or index >= static_cast<int>(dimension_)) {
-			std::stringstream error_stream;
-			error_stream << "Index ";
-			error_stream << index;
-			error_stream << " is not valid for this euclidean_vector object";
-			throw euclidean_vector_error(error_stream.str());
+			detail::throw_index_error(index);
 		}
 		reset_norm();
 		return magnitude_[static_cast<size_t>(index)];
 	}
 
+	auto euclidean_vector::set(int index, double value) -> void {
+		if (index < 0 or index >= static_cast<int>(dimension_)) {
+			detail::throw_index_error(index);
+		}
+		auto& component = magnitude_[static_cast<size_t>(index)];
+		auto const squared_norm = squared_norm_.load(std::memory_order_relaxed);
+		auto const old_square = component * component;
+		auto const updated = squared_norm - old_square + value * value;
+		component = value;
+		// the running sum carries an error of about epsilon * the largest sum it held,
+		// drop it if that could be more than 2^-20 of the new sum
+		// an overflowed sum is dropped too, inf - inf would cache a NaN
+		if (squared_norm == -1 or incremental_updates_ + 1 >= exact_norm_interval
+		    or not std::isfinite(updated)
+		    or updated < std::max(squared_norm, old_square) * 0x1p-20) {
+			reset_norm();
+			return;
+		}
+		++incremental_updates_;
+		squared_norm_.store(updated, std::memory_order_relaxed);
+		norm_.store(-1, std::memory_order_relaxed);
+	}
+
 	// Utility function norm
 	// I apply friend to this function
 	// therefore, I can change the mutable private data member norm_
+	// concurrent callers may both compute the norm, but they store the same value
 	auto euclidean_norm(euclidean_vector const& v) -> double {
 		if (v.dimensions() == 0) {
 			return 0.0;
 		}
-		if (v.norm_ != -1) {
-			return v.norm_;
+		auto const cached = v.norm_.load(std::memory_order_relaxed);
+		if (cached != -1) {
+			return cached;
 		}
-		auto sum = 0.0;
-		std::for_each (v.magnitude_.get(), v.magnitude_.get() + v.dimension_, [&sum](auto const n) {
-			sum += n * n;
-		});
-		v.norm_ = sqrt(sum);
-		return v.norm_;
+		auto const norm = std::sqrt(squared_euclidean_norm(v));
+		v.norm_.store(norm, std::memory_order_relaxed);
+		return norm;
+	}
+
+	// Utility function squared norm
+	auto squared_euclidean_norm(euclidean_vector const& v) -> double {
+		if (v.dimensions() == 0) {
+			return 0.0;
+		}
+		auto const cached = v.squared_norm_.load(std::memory_order_relaxed);
+		if (cached != -1) {
+			return cached;
+		}
+		auto const sum = detail::squared_norm(v.magnitude_.get(), v.dimension_);
+		v.squared_norm_.store(sum, std::memory_order_relaxed);
+		return sum;
 	}
 
 	// Utility function unit
@@ -194,21 +776,1330 @@ namespace comp6771 {
 	// convert euclidean vector into std::vector to avoid using for loop
 	auto dot(euclidean_vector const& x, euclidean_vector const& y) -> double {
 		if (x.dimensions() != y.dimensions()) {
-			auto x_d = x.dimensions();
-			auto y_d = y.dimensions();
-			std::stringstream error_stream;
-			error_stream << "Dimensions of LHS(";
-			error_stream << x_d;
-			error_stream << ") and RHS(";
-			error_stream << y_d;
-			error_stream << ") do not match";
-			throw euclidean_vector_error(error_stream.str());
+			detail::throw_dimension_error(x.dimension_, y.dimension_);
 		}
 
-		auto sum = std::inner_product(x.magnitude_.get(),
-		                              x.magnitude_.get() + x.dimension_,
-		                              y.magnitude_.get(),
-		                              0.0);
+		auto sum = detail::dot(x.magnitude_.get(), y.magnitude_.get(), x.dimension_);
 		return sum;
 	}
+
+	auto operator==(const_euclidean_vector_view lhs, const_euclidean_vector_view rhs) -> bool {
+		if (lhs.dimensions() != rhs.dimensions()) {
+			return false;
+		}
+		return std::equal(lhs.data(), lhs.data() + lhs.dimensions(), rhs.data());
+	}
+
+	auto hash_value(const_euclidean_vector_view v) noexcept -> std::size_t {
+		constexpr auto multiplier = std::uint64_t{0x9e3779b97f4a7c15};
+		// adding 0.0 turns -0.0 into 0.0
+		auto const bits = [](double n) { return std::bit_cast<std::uint64_t>(n + 0.0); };
+		auto const length = static_cast<std::size_t>(v.dimensions());
+		auto const x = v.data();
+		std::uint64_t lanes[hash_lanes] = {1, 2, 3, 4}; // NOLINT(modernize-avoid-c-arrays)
+		auto k = std::size_t{0};
+		for (; k + hash_lanes <= length; k += hash_lanes) {
+			for (auto t = std::size_t{0}; t < hash_lanes; ++t) {
+				lanes[t] = (lanes[t] ^ bits(x[k + t])) * multiplier;
+				lanes[t] ^= lanes[t] >> 32U;
+			}
+		}
+		for (; k < length; ++k) {
+			lanes[0] = (lanes[0] ^ bits(x[k])) * multiplier;
+			lanes[0] ^= lanes[0] >> 32U;
+		}
+		auto hash = mix(length);
+		for (auto const lane : lanes) {
+			hash = mix(hash ^ lane);
+		}
+		return static_cast<std::size_t>(hash);
+	}
+
+	auto approx_equal(const_euclidean_vector_view x,
+	                  const_euclidean_vector_view y,
+	                  double relative_tolerance,
+	                  double absolute_tolerance) -> bool {
+		if (x.dimensions() != y.dimensions()) {
+			return false;
+		}
+		return std::equal(x.data(),
+		                  x.data() + x.dimensions(),
+		                  y.data(),
+		                  [relative_tolerance, absolute_tolerance](double a, double b) {
+			                  auto const tolerance =
+			                     std::max(relative_tolerance * std::max(std::abs(a), std::abs(b)),
+			                              absolute_tolerance);
+			                  // an infinity is only close to itself, as in isclose,
+			                  // otherwise its infinite tolerance would accept anything
+			                  if (a == b) {
+				                  return true;
+			                  }
+			                  return std::isfinite(a) and std::isfinite(b)
+			                         and std::abs(a - b) <= tolerance;
+		                  });
+	}
+
+	// the normals are standard gaussians from Box-Muller over a splitmix64 stream,
+	// which unlike std::normal_distribution gives the same planes on every library
+	hyperplane_hasher::hyperplane_hasher(int dimension, int bits, std::uint64_t seed)
+	: dimension_(static_cast<std::size_t>(dimension))
+	, bits_(bits) {
+		if (bits < 1 or bits > 64) {
+			throw euclidean_vector_error("hyperplane_hasher needs between 1 and 64 bits");
+		}
+		auto state = seed;
+		auto const uniform = [&state] {
+			state += 0x9e3779b97f4a7c15U;
+			// 53 random bits in (0, 1]
+			return static_cast<double>((mix(state) >> 11U) + 1) * 0x1.0p-53;
+		};
+		planes_.resize(static_cast<std::size_t>(bits_) * dimension_);
+		for (auto& n : planes_) {
+			n = std::sqrt(-2.0 * std::log(uniform())) * std::cos(2.0 * std::numbers::pi * uniform());
+		}
+	}
+
+	auto hyperplane_hasher::operator()(const_euclidean_vector_view v) const -> std::uint64_t {
+		if (static_cast<std::size_t>(v.dimensions()) != dimension_) {
+			detail::throw_dimension_error(static_cast<std::size_t>(v.dimensions()), dimension_);
+		}
+		auto signature = std::uint64_t{0};
+		for (auto b = 0; b < bits_; ++b) {
+			auto const plane = planes_.data() + static_cast<std::size_t>(b) * dimension_;
+			if (row_dot(v.data(), plane, dimension_) >= 0.0) {
+				signature |= std::uint64_t{1} << static_cast<unsigned>(b);
+			}
+		}
+		return signature;
+	}
+
+	auto linear_combination(std::span<double const> coefficients,
+	                        std::span<euclidean_vector const> vectors) -> euclidean_vector {
+		if (coefficients.size() != vectors.size()) {
+			throw euclidean_vector_error("linear_combination needs one coefficient per vector");
+		}
+		if (vectors.empty()) {
+			throw euclidean_vector_error("linear_combination needs at least one vector");
+		}
+		auto const length = static_cast<std::size_t>(vectors.front().dimensions());
+		for (auto const& v : vectors) {
+			if (static_cast<std::size_t>(v.dimensions()) != length) {
+				detail::throw_dimension_error(length, static_cast<std::size_t>(v.dimensions()));
+			}
+		}
+		auto result = euclidean_vector(static_cast<int>(length));
+		auto const out = result.data();
+		for_each_chunk(length, [&coefficients, &vectors, out](std::size_t first, std::size_t last) {
+			for (auto block = first; block < last; block += combination_block) {
+				auto const block_end = std::min(block + combination_block, last);
+				auto const x = vectors.front().data();
+				for (auto i = block; i < block_end; ++i) {
+					out[i] = coefficients.front() * x[i];
+				}
+				for (auto k = std::size_t{1}; k < vectors.size(); ++k) {
+					auto const alpha = coefficients[k];
+					auto const y = vectors[k].data();
+					for (auto i = block; i < block_end; ++i) {
+						out[i] = multiply_add(alpha, y[i], out[i]);
+					}
+				}
+			}
+		});
+		return result;
+	}
+
+	// components are formatted into a small local buffer
+	// which is written to os whenever it fills up
+	// the text is written in blocks straight to the stream, unless a field width
+	// is set, then the whole vector is built first so it can be padded as one field
+	auto operator<<(std::ostream& os, const_euclidean_vector_view v) -> std::ostream& {
+		if (os.width() != 0) {
+			return os << std::string_view(to_string(v));
+		}
+		constexpr auto buffer_size = std::size_t{512};
+		char buffer[buffer_size]; // NOLINT(modernize-avoid-c-arrays)
+		auto const buffer_end = buffer + buffer_size;
+		auto out = buffer;
+		*out++ = '[';
+		for (auto i = 0; i < v.dimensions(); ++i) {
+			if (buffer_end - out < static_cast<std::ptrdiff_t>(max_component_chars)) {
+				os.write(buffer, out - buffer);
+				out = buffer;
+			}
+			if (i != 0) {
+				*out++ = ' ';
+			}
+			out = format_component(out, buffer_end, v[i]).ptr;
+		}
+		*out++ = ']';
+		os.write(buffer, out - buffer);
+		return os;
+	}
+
+	auto operator<<(std::ostream& os, euclidean_vector const& orig) -> std::ostream& {
+		return os << const_euclidean_vector_view(orig);
+	}
+
+	auto to_chars(char* first, char* last, const_euclidean_vector_view v) -> std::to_chars_result {
+		auto const too_large = std::to_chars_result{last, std::errc::value_too_large};
+		if (first == last) {
+			return too_large;
+		}
+		*first++ = '[';
+		for (auto i = 0; i < v.dimensions(); ++i) {
+			if (i != 0) {
+				if (first == last) {
+					return too_large;
+				}
+				*first++ = ' ';
+			}
+			auto const result = format_component(first, last, v[i]);
+			if (result.ec != std::errc{}) {
+				return too_large;
+			}
+			first = result.ptr;
+		}
+		if (first == last) {
+			return too_large;
+		}
+		*first++ = ']';
+		return {first, std::errc{}};
+	}
+
+	auto to_string(const_euclidean_vector_view v) -> std::string {
+		auto text = std::string(2 + static_cast<std::size_t>(v.dimensions()) * max_component_chars, ' ');
+		auto const result = to_chars(text.data(), text.data() + text.size(), v);
+		text.resize(static_cast<std::size_t>(result.ptr - text.data()));
+		return text;
+	}
+
+	// the text is scanned twice, once to count the components
+	// and once to parse them straight into v's buffer
+	auto from_string(std::string_view text, euclidean_vector& v) -> void {
+		auto dimension = std::size_t{0};
+		parse_components(text, [&dimension](double) { ++dimension; });
+		v.resize_for_overwrite(dimension);
+		auto i = std::size_t{0};
+		parse_components(text, [&v, &i](double value) { v.magnitude_[i++] = value; });
+	}
+
+	auto from_string(std::string_view text) -> euclidean_vector {
+		auto v = euclidean_vector(0);
+		from_string(text, v);
+		return v;
+	}
+
+	auto euclidean_norm(const_euclidean_vector_view v) -> double {
+		return std::sqrt(squared_euclidean_norm(v));
+	}
+
+	auto squared_euclidean_norm(const_euclidean_vector_view v) -> double {
+		return detail::squared_norm(v.data(), static_cast<std::size_t>(v.dimensions()));
+	}
+
+	auto dot(const_euclidean_vector_view x, const_euclidean_vector_view y, summation mode)
+	   -> double {
+		if (mode == summation::fast) {
+			return dot(x, y);
+		}
+		if (x.dimensions() != y.dimensions()) {
+			detail::throw_dimension_error(static_cast<std::size_t>(x.dimensions()),
+			                              static_cast<std::size_t>(y.dimensions()));
+		}
+		return compensated_dot(x.data(), y.data(), static_cast<std::size_t>(x.dimensions()));
+	}
+
+	auto squared_euclidean_norm(const_euclidean_vector_view v, summation mode) -> double {
+		if (mode == summation::fast) {
+			return squared_euclidean_norm(v);
+		}
+		return compensated_dot(v.data(), v.data(), static_cast<std::size_t>(v.dimensions()));
+	}
+
+	auto euclidean_norm(const_euclidean_vector_view v, summation mode) -> double {
+		return std::sqrt(squared_euclidean_norm(v, mode));
+	}
+
+	auto unit(const_euclidean_vector_view v) -> euclidean_vector {
+		if (v.dimensions() == 0) {
+			throw euclidean_vector_error("euclidean_vector with no dimensions does not have a unit "
+			                             "vector");
+		}
+		auto norm = euclidean_norm(v);
+		if (norm == 0.0) {
+			throw euclidean_vector_error("euclidean_vector with zero euclidean normal does not have a "
+			                             "unit vector");
+		}
+		auto copy = euclidean_vector(v);
+		copy /= norm;
+		return copy;
+	}
+
+	auto dot(const_euclidean_vector_view x, const_euclidean_vector_view y) -> double {
+		if (x.dimensions() != y.dimensions()) {
+			detail::throw_dimension_error(static_cast<std::size_t>(x.dimensions()),
+			                              static_cast<std::size_t>(y.dimensions()));
+		}
+		return detail::dot(x.data(), y.data(), static_cast<std::size_t>(x.dimensions()));
+	}
+
+	// Utility function batched dot
+	// ys are split into cache sized blocks and each block is multiplied
+	// against every 4 x 4 tile of xs, leftover rows and columns use a serial
+	// std::inner_product, which sums in the same order as the tile kernel
+	auto dot(std::span<euclidean_vector const> xs, std::span<euclidean_vector const> ys)
+	   -> std::vector<double> {
+		auto result = std::vector<double>(xs.size() * ys.size());
+		if (xs.empty() or ys.empty()) {
+			return result;
+		}
+		auto const length = xs.front().dimension_;
+		for (auto const& x : xs) {
+			if (x.dimension_ != length) {
+				detail::throw_dimension_error(x.dimension_, length);
+			}
+		}
+		for (auto const& y : ys) {
+			if (y.dimension_ != length) {
+				detail::throw_dimension_error(length, y.dimension_);
+			}
+		}
+
+		auto const stride = ys.size();
+		auto const block = std::max(dot_tile,
+		                            dot_block_bytes / std::max(length * sizeof(double), std::size_t{1})
+		                               / dot_tile * dot_tile);
+		auto const x_tiles = (xs.size() + dot_tile - 1) / dot_tile;
+		for (auto jb = std::size_t{0}; jb < ys.size(); jb += block) {
+			auto const j_end = std::min(jb + block, ys.size());
+			// one task per tile of xs, each writes its own rows of the result
+			auto const tile_row = [&xs, &ys, &result, jb, j_end, stride, length](std::size_t tile) {
+				auto const i = tile * dot_tile;
+				if (i + dot_tile > xs.size()) {
+					for (auto r = i; r < xs.size(); ++r) {
+						for (auto j = jb; j < j_end; ++j) {
+							result[r * stride + j] = std::inner_product(xs[r].magnitude_.get(),
+							                                            xs[r].magnitude_.get() + length,
+							                                            ys[j].magnitude_.get(),
+							                                            0.0);
+						}
+					}
+					return;
+				}
+				double const* x_rows[dot_tile] = {}; // NOLINT(modernize-avoid-c-arrays)
+				for (auto t = std::size_t{0}; t < dot_tile; ++t) {
+					x_rows[t] = xs[i + t].magnitude_.get();
+				}
+				auto j = jb;
+				for (; j + dot_tile <= j_end; j += dot_tile) {
+					double const* y_rows[dot_tile] = {}; // NOLINT(modernize-avoid-c-arrays)
+					for (auto t = std::size_t{0}; t < dot_tile; ++t) {
+						y_rows[t] = ys[j + t].magnitude_.get();
+					}
+					dot_kernel_4x4(x_rows, y_rows, length, result.data() + i * stride + j, stride);
+				}
+				for (; j < j_end; ++j) {
+					for (auto t = std::size_t{0}; t < dot_tile; ++t) {
+						result[(i + t) * stride + j] = std::inner_product(x_rows[t],
+						                                                  x_rows[t] + length,
+						                                                  ys[j].magnitude_.get(),
+						                                                  0.0);
+					}
+				}
+			};
+			if (xs.size() * (j_end - jb) * length < parallel_threshold) {
+				for (auto tile = std::size_t{0}; tile < x_tiles; ++tile) {
+					tile_row(tile);
+				}
+			}
+			else {
+				parallel_for(x_tiles, tile_row);
+			}
+		}
+		return result;
+	}
+
+	auto squared_distance(euclidean_vector const& a, euclidean_vector const& b) -> double {
+		auto const cross = dot(a, b);
+		return std::max(squared_euclidean_norm(a) + squared_euclidean_norm(b) - 2.0 * cross, 0.0);
+	}
+
+	auto pairwise_squared_distances(std::span<euclidean_vector const> xs,
+	                                std::span<euclidean_vector const> ys) -> std::vector<double> {
+		auto result = dot(xs, ys);
+		auto y_norms = std::vector<double>(ys.size());
+		std::transform(ys.begin(), ys.end(), y_norms.begin(), [](euclidean_vector const& y) {
+			return squared_euclidean_norm(y);
+		});
+		auto const stride = ys.size();
+		for (auto i = std::size_t{0}; i < xs.size(); ++i) {
+			auto const x_norm = squared_euclidean_norm(xs[i]);
+			auto const first = result.begin() + static_cast<std::ptrdiff_t>(i * stride);
+			std::transform(first, first + static_cast<std::ptrdiff_t>(stride), y_norms.begin(), first,
+			               [x_norm](double cross, double y_norm) {
+				               return std::max(x_norm + y_norm - 2.0 * cross, 0.0);
+			               });
+		}
+		return result;
+	}
+
+	// the upper triangle is mirrored so the matrix is exactly symmetric
+	auto pairwise_distances(std::span<euclidean_vector const> batch) -> std::vector<double> {
+		auto result = pairwise_squared_distances(batch, batch);
+		auto const n = batch.size();
+		for (auto i = std::size_t{0}; i < n; ++i) {
+			result[i * n + i] = 0.0;
+			for (auto j = i + 1; j < n; ++j) {
+				result[i * n + j] = std::sqrt(result[i * n + j]);
+				result[j * n + i] = result[i * n + j];
+			}
+		}
+		return result;
+	}
+
+	// the assignment step runs in parallel over blocks of points, the update step
+	// adds the points in order so the centroids do not depend on the thread count
+	auto kmeans_step(std::span<euclidean_vector const> points,
+	                 std::span<euclidean_vector> centroids,
+	                 std::span<std::size_t> assignment) -> std::size_t {
+		if (centroids.empty()) {
+			throw euclidean_vector_error("k-means needs at least one centroid");
+		}
+		if (assignment.size() != points.size()) {
+			throw euclidean_vector_error("k-means needs one assignment per point");
+		}
+		auto const length = centroids.front().dimension_;
+		for (auto const& c : centroids) {
+			if (c.dimension_ != length) {
+				detail::throw_dimension_error(c.dimension_, length);
+			}
+		}
+		for (auto const& p : points) {
+			if (p.dimension_ != length) {
+				detail::throw_dimension_error(p.dimension_, length);
+			}
+		}
+
+		auto const k = centroids.size();
+		auto centroid_norms = std::vector<double>(k);
+		for (auto c = std::size_t{0}; c < k; ++c) {
+			centroid_norms[c] = squared_euclidean_norm(centroids[c]);
+		}
+		auto const point = [&points](std::size_t i) -> double const* {
+			return points[i].magnitude_.get();
+		};
+		auto const centroid = [&centroids](std::size_t c) -> double* {
+			return centroids[c].magnitude_.get();
+		};
+		auto const changed =
+		   assign_to_nearest(points.size(), point, centroid, centroid_norms, length, assignment);
+		auto const counts = move_to_means(points.size(), point, k, centroid, length, assignment);
+		for (auto c = std::size_t{0}; c < k; ++c) {
+			if (counts[c] != 0) {
+				centroids[c].reset_norm();
+			}
+		}
+		return changed;
+	}
+
+	auto kmeans(std::span<euclidean_vector const> points,
+	            std::span<euclidean_vector> centroids,
+	            std::span<std::size_t> assignment,
+	            int max_iterations) -> int {
+		auto iterations = 0;
+		while (iterations < max_iterations) {
+			++iterations;
+			if (kmeans_step(points, centroids, assignment) == 0) {
+				break;
+			}
+		}
+		return iterations;
+	}
+
+	sparse_euclidean_vector::sparse_euclidean_vector(int dimension)
+	: dimension_(static_cast<std::size_t>(dimension)) {}
+
+	sparse_euclidean_vector::sparse_euclidean_vector(int dimension,
+	                                                 std::vector<std::pair<int, double>> entries)
+	: dimension_(static_cast<std::size_t>(dimension)) {
+		std::sort(entries.begin(), entries.end(), [](auto const& a, auto const& b) {
+			return a.first < b.first;
+		});
+		for (auto const& [index, value] : entries) {
+			if (index < 0 or index >= dimension) {
+				detail::throw_index_error(index);
+			}
+			if (not indices_.empty() and indices_.back() == static_cast<std::uint32_t>(index)) {
+				values_.back() += value;
+			}
+			else {
+				indices_.push_back(static_cast<std::uint32_t>(index));
+				values_.push_back(value);
+			}
+		}
+		drop_zeros();
+		maybe_densify();
+	}
+
+	sparse_euclidean_vector::sparse_euclidean_vector(const_euclidean_vector_view v)
+	: dimension_(static_cast<std::size_t>(v.dimensions())) {
+		for (auto i = std::size_t{0}; i < dimension_; ++i) {
+			if (v.data()[i] != 0.0) {
+				indices_.push_back(static_cast<std::uint32_t>(i));
+				values_.push_back(v.data()[i]);
+			}
+		}
+		maybe_densify();
+	}
+
+	sparse_euclidean_vector::operator euclidean_vector() const {
+		if (dense_) {
+			return *dense_;
+		}
+		auto v = euclidean_vector(static_cast<int>(dimension_));
+		auto const data = v.data();
+		for (auto k = std::size_t{0}; k < indices_.size(); ++k) {
+			data[indices_[k]] = values_[k];
+		}
+		return v;
+	}
+
+	auto sparse_euclidean_vector::operator[](int index) const -> double {
+		assert(index >= 0 and index < static_cast<int>(dimension_));
+		if (dense_) {
+			return (*dense_)[index];
+		}
+		auto const it = std::lower_bound(indices_.begin(), indices_.end(), index);
+		if (it == indices_.end() or *it != static_cast<std::uint32_t>(index)) {
+			return 0.0;
+		}
+		return values_[static_cast<std::size_t>(it - indices_.begin())];
+	}
+
+	auto sparse_euclidean_vector::set(int index, double value) -> void {
+		if (index < 0 or index >= static_cast<int>(dimension_)) {
+			detail::throw_index_error(index);
+		}
+		if (dense_) {
+			(*dense_)[index] = value;
+			return;
+		}
+		auto const it = std::lower_bound(indices_.begin(), indices_.end(), index);
+		auto const position = it - indices_.begin();
+		if (it != indices_.end() and *it == static_cast<std::uint32_t>(index)) {
+			if (value == 0.0) {
+				indices_.erase(it);
+				values_.erase(values_.begin() + position);
+			}
+			else {
+				values_[static_cast<std::size_t>(position)] = value;
+			}
+			return;
+		}
+		if (value == 0.0) {
+			return;
+		}
+		indices_.insert(it, static_cast<std::uint32_t>(index));
+		values_.insert(values_.begin() + position, value);
+		maybe_densify();
+	}
+
+	auto sparse_euclidean_vector::maybe_densify() -> void {
+		if (dense_
+		    or static_cast<double>(indices_.size())
+		          <= densify_threshold * static_cast<double>(dimension_)) {
+			return;
+		}
+		dense_ = static_cast<euclidean_vector>(*this);
+		indices_ = {};
+		values_ = {};
+	}
+
+	auto sparse_euclidean_vector::drop_zeros() noexcept -> void {
+		auto kept = std::size_t{0};
+		for (auto k = std::size_t{0}; k < indices_.size(); ++k) {
+			if (values_[k] != 0.0) {
+				indices_[kept] = indices_[k];
+				values_[kept] = values_[k];
+				++kept;
+			}
+		}
+		indices_.resize(kept);
+		values_.resize(kept);
+	}
+
+	auto sparse_euclidean_vector::add(sparse_euclidean_vector const& rhs, double sign) -> void {
+		if (rhs.dimension_ != dimension_) {
+			detail::throw_dimension_error(dimension_, rhs.dimension_);
+		}
+		// a dense operand makes the result dense
+		if (rhs.dense_ and not dense_) {
+			dense_ = static_cast<euclidean_vector>(*this);
+			indices_ = {};
+			values_ = {};
+		}
+		if (dense_) {
+			if (rhs.dense_) {
+				dense_->axpy(sign, *rhs.dense_);
+				return;
+			}
+			auto const data = dense_->data();
+			for (auto k = std::size_t{0}; k < rhs.indices_.size(); ++k) {
+				data[rhs.indices_[k]] += sign * rhs.values_[k];
+			}
+			return;
+		}
+		// both sparse, merge the two sorted index lists
+		auto indices = std::vector<std::uint32_t>();
+		auto values = std::vector<double>();
+		indices.reserve(indices_.size() + rhs.indices_.size());
+		values.reserve(indices_.size() + rhs.indices_.size());
+		auto i = std::size_t{0};
+		auto j = std::size_t{0};
+		while (i < indices_.size() or j < rhs.indices_.size()) {
+			if (j == rhs.indices_.size() or (i < indices_.size() and indices_[i] < rhs.indices_[j])) {
+				indices.push_back(indices_[i]);
+				values.push_back(values_[i++]);
+			}
+			else if (i == indices_.size() or rhs.indices_[j] < indices_[i]) {
+				indices.push_back(rhs.indices_[j]);
+				values.push_back(sign * rhs.values_[j++]);
+			}
+			else if (auto const sum = values_[i] + sign * rhs.values_[j]; sum != 0.0) {
+				indices.push_back(indices_[i++]);
+				values.push_back(sum);
+				++j;
+			}
+			else {
+				++i;
+				++j;
+			}
+		}
+		indices_ = std::move(indices);
+		values_ = std::move(values);
+		maybe_densify();
+	}
+
+	auto sparse_euclidean_vector::operator+=(sparse_euclidean_vector const& rhs)
+	   -> sparse_euclidean_vector& {
+		add(rhs, 1.0);
+		return *this;
+	}
+
+	auto sparse_euclidean_vector::operator-=(sparse_euclidean_vector const& rhs)
+	   -> sparse_euclidean_vector& {
+		add(rhs, -1.0);
+		return *this;
+	}
+
+	auto sparse_euclidean_vector::operator*=(double scalar) noexcept -> sparse_euclidean_vector& {
+		if (dense_) {
+			*dense_ *= scalar;
+		}
+		else {
+			detail::multiply(values_.data(), scalar, values_.size());
+			drop_zeros();
+		}
+		return *this;
+	}
+
+	auto sparse_euclidean_vector::operator/=(double dividend) -> sparse_euclidean_vector& {
+		if (dividend == 0.0) {
+			detail::throw_division_by_zero();
+		}
+		if (dense_) {
+			*dense_ /= dividend;
+		}
+		else {
+			detail::divide(values_.data(), dividend, values_.size());
+			drop_zeros();
+		}
+		return *this;
+	}
+
+	// dense storage compares equal to its sparse form
+	// two sparse forms hold no zeros, so they are equal when they store the same pairs
+	auto operator==(sparse_euclidean_vector const& lhs, sparse_euclidean_vector const& rhs) -> bool {
+		if (lhs.dimension_ != rhs.dimension_) {
+			return false;
+		}
+		if (lhs.dense_ or rhs.dense_) {
+			return static_cast<euclidean_vector>(lhs) == static_cast<euclidean_vector>(rhs);
+		}
+		return lhs.indices_ == rhs.indices_ and lhs.values_ == rhs.values_;
+	}
+
+	auto euclidean_norm(sparse_euclidean_vector const& v) -> double {
+		if (v.dense_) {
+			return euclidean_norm(*v.dense_);
+		}
+		return std::sqrt(detail::squared_norm(v.values_.data(), v.values_.size()));
+	}
+
+	auto dot(sparse_euclidean_vector const& x, sparse_euclidean_vector const& y) -> double {
+		if (x.dimension_ != y.dimension_) {
+			detail::throw_dimension_error(x.dimension_, y.dimension_);
+		}
+		if (x.dense_) {
+			return dot(y, *x.dense_);
+		}
+		if (y.dense_) {
+			return dot(x, *y.dense_);
+		}
+		// intersect the two sorted index lists
+		auto sum = 0.0;
+		auto i = std::size_t{0};
+		auto j = std::size_t{0};
+		while (i < x.indices_.size() and j < y.indices_.size()) {
+			if (x.indices_[i] < y.indices_[j]) {
+				++i;
+			}
+			else if (y.indices_[j] < x.indices_[i]) {
+				++j;
+			}
+			else {
+				sum += x.values_[i++] * y.values_[j++];
+			}
+		}
+		return sum;
+	}
+
+	auto dot(sparse_euclidean_vector const& x, const_euclidean_vector_view y) -> double {
+		if (x.dimension_ != static_cast<std::size_t>(y.dimensions())) {
+			detail::throw_dimension_error(x.dimension_, static_cast<std::size_t>(y.dimensions()));
+		}
+		if (x.dense_) {
+			return dot(*x.dense_, y);
+		}
+		auto sum = 0.0;
+		for (auto k = std::size_t{0}; k < x.indices_.size(); ++k) {
+			sum += x.values_[k] * y.data()[x.indices_[k]];
+		}
+		return sum;
+	}
+
+	auto dot(const_euclidean_vector_view x, sparse_euclidean_vector const& y) -> double {
+		return dot(y, x);
+	}
+
+	auto binary_writer::write(const_euclidean_vector_view v) -> void {
+		auto header = static_cast<std::uint64_t>(v.dimensions());
+		to_little_endian(&header, 1);
+		os_->write(reinterpret_cast<char const*>(&header), sizeof(header));
+		auto const bytes = static_cast<std::streamsize>(sizeof(double)) * v.dimensions();
+		if constexpr (std::endian::native == std::endian::little) {
+			os_->write(reinterpret_cast<char const*>(v.data()), bytes);
+		}
+		else {
+			auto swapped = std::vector<std::uint64_t>(static_cast<std::size_t>(v.dimensions()));
+			std::transform(v.data(), v.data() + v.dimensions(), swapped.begin(), [](double n) {
+				return std::bit_cast<std::uint64_t>(n);
+			});
+			to_little_endian(swapped.data(), swapped.size());
+			os_->write(reinterpret_cast<char const*>(swapped.data()), bytes);
+		}
+	}
+
+	auto binary_reader::read(euclidean_vector& v) -> bool {
+		auto header = std::uint64_t{0};
+		is_->read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (is_->gcount() == 0) {
+			return false;
+		}
+		if (is_->gcount() != sizeof(header)) {
+			throw truncated_error();
+		}
+		to_little_endian(&header, 1);
+		if (not valid_header(header)) {
+			throw corrupt_header_error();
+		}
+		// checked before v is touched when the stream can tell how much is left,
+		// so a bad header cannot make v allocate more than the input holds
+		auto const bytes = static_cast<std::streamsize>(sizeof(double) * header);
+		if (auto const remaining = remaining_bytes(*is_); remaining != -1 and remaining < bytes) {
+			throw truncated_error();
+		}
+		v.resize_for_overwrite(static_cast<std::size_t>(header));
+		is_->read(reinterpret_cast<char*>(v.magnitude_.get()), bytes);
+		if (is_->gcount() != bytes) {
+			// don't leave v holding part of a vector
+			v.dimension_ = 0;
+			v.reset_norm();
+			throw truncated_error();
+		}
+		// doubles and uint64s have the same size, swap the raw bits in place
+		if constexpr (std::endian::native != std::endian::little) {
+			for (auto i = std::size_t{0}; i < v.dimension_; ++i) {
+				auto const bits = byteswap(std::bit_cast<std::uint64_t>(v.magnitude_[i]));
+				v.magnitude_[i] = std::bit_cast<double>(bits);
+			}
+		}
+		return true;
+	}
+
+	auto binary_reader::read() -> std::optional<euclidean_vector> {
+		auto v = euclidean_vector(0);
+		if (not read(v)) {
+			return std::nullopt;
+		}
+		return v;
+	}
+
+	binary_buffer_reader::binary_buffer_reader(std::span<std::byte const> buffer)
+	: buffer_(buffer) {
+		if constexpr (std::endian::native != std::endian::little) {
+			throw euclidean_vector_error("binary_buffer_reader needs a little-endian host");
+		}
+		if (reinterpret_cast<std::uintptr_t>(buffer_.data()) % alignof(double) != 0) {
+			throw euclidean_vector_error("binary_buffer_reader needs an 8-byte aligned buffer");
+		}
+	}
+
+	auto binary_buffer_reader::next() -> std::optional<const_euclidean_vector_view> {
+		if (offset_ == buffer_.size()) {
+			return std::nullopt;
+		}
+		auto header = std::uint64_t{0};
+		if (buffer_.size() - offset_ < sizeof(header)) {
+			throw truncated_error();
+		}
+		std::memcpy(&header, buffer_.data() + offset_, sizeof(header));
+		if (not valid_header(header)) {
+			throw corrupt_header_error();
+		}
+		if ((buffer_.size() - offset_ - sizeof(header)) / sizeof(double) < header) {
+			throw truncated_error();
+		}
+		// the header keeps every vector 8-byte aligned
+		offset_ += sizeof(header);
+		auto const first = reinterpret_cast<double const*>(buffer_.data() + offset_);
+		auto const dimension = static_cast<std::size_t>(header);
+		offset_ += dimension * sizeof(double);
+		return const_euclidean_vector_view(first, dimension);
+	}
+
+	knn_index::knn_index(std::span<euclidean_vector const> vectors, distance_metric metric)
+	: metric_(metric)
+	, dimension_(vectors.empty() ? 0 : vectors.front().dimension_)
+	, size_(vectors.size()) {
+		data_.reserve(size_ * dimension_);
+		squared_norms_.reserve(size_);
+		for (auto const& v : vectors) {
+			if (v.dimension_ != dimension_) {
+				detail::throw_dimension_error(v.dimension_, dimension_);
+			}
+			auto const first = v.magnitude_.get();
+			auto const squared_norm = row_dot(first, first, dimension_);
+			if (metric_ == distance_metric::cosine and squared_norm != 0.0) {
+				auto const norm = std::sqrt(squared_norm);
+				std::transform(first, first + dimension_, std::back_inserter(data_), [norm](double n) {
+					return n / norm;
+				});
+				squared_norms_.push_back(1.0);
+			}
+			else {
+				data_.insert(data_.end(), first, first + dimension_);
+				squared_norms_.push_back(squared_norm);
+			}
+		}
+	}
+
+	// Lloyd's k-means on the stored rows, with the same steps as kmeans_step
+	// centroids start at evenly spaced rows so the build is deterministic
+	auto knn_index::build_ivf(std::size_t lists, int iterations) -> void {
+		if (lists == 0 or lists > size_) {
+			throw euclidean_vector_error("IVF list count must be between 1 and the number of "
+			                             "indexed vectors");
+		}
+		if (iterations < 0) {
+			throw euclidean_vector_error("IVF iteration count must not be negative");
+		}
+		centroids_.assign(lists * dimension_, 0.0);
+		for (auto c = std::size_t{0}; c < lists; ++c) {
+			auto const first = row(c * size_ / lists);
+			std::copy(first,
+			          first + dimension_,
+			          centroids_.begin() + static_cast<std::ptrdiff_t>(c * dimension_));
+		}
+		centroid_squared_norms_.assign(lists, 0.0);
+		auto const point = [this](std::size_t i) {
+			return row(i);
+		};
+		auto const centroid = [this](std::size_t c) {
+			return centroids_.data() + c * dimension_;
+		};
+		auto const update_norms = [this, &centroid] {
+			for (auto c = std::size_t{0}; c < centroid_squared_norms_.size(); ++c) {
+				centroid_squared_norms_[c] = row_dot(centroid(c), centroid(c), dimension_);
+			}
+		};
+		auto assignment = std::vector<std::size_t>(size_);
+		for (auto round = 0; round < iterations; ++round) {
+			update_norms();
+			auto const changed =
+			   assign_to_nearest(size_, point, centroid, centroid_squared_norms_, dimension_, assignment);
+			// unchanged lists mean the centroids are already their means
+			if (changed == 0 and round > 0) {
+				break;
+			}
+			move_to_means(size_, point, lists, centroid, dimension_, assignment);
+		}
+		// a last assignment, so the lists match the final centroids
+		update_norms();
+		assign_to_nearest(size_, point, centroid, centroid_squared_norms_, dimension_, assignment);
+		lists_.assign(lists, {});
+		for (auto i = std::size_t{0}; i < size_; ++i) {
+			lists_[assignment[i]].push_back(i);
+		}
+	}
+
+	auto knn_index::search(euclidean_vector const& query, std::size_t k) const
+	   -> std::vector<neighbour> {
+		auto const q = prepare_query(query);
+		auto const q_squared_norm = row_dot(q.data(), q.data(), dimension_);
+		auto best = std::vector<neighbour>();
+		best.reserve(k + 1);
+		for (auto i = std::size_t{0}; i < size_; ++i) {
+			consider(q, q_squared_norm, i, k, best);
+		}
+		return finish(std::move(best));
+	}
+
+	auto knn_index::search_approximate(euclidean_vector const& query,
+	                                   std::size_t k,
+	                                   std::size_t probes) const -> std::vector<neighbour> {
+		if (lists_.empty()) {
+			throw euclidean_vector_error("knn_index::build_ivf must be called before "
+			                             "search_approximate");
+		}
+		auto const q = prepare_query(query);
+		auto const q_squared_norm = row_dot(q.data(), q.data(), dimension_);
+
+		// rank the lists by centroid distance and keep the closest `probes`
+		auto order = std::vector<neighbour>();
+		order.reserve(lists_.size());
+		for (auto c = std::size_t{0}; c < lists_.size(); ++c) {
+			auto const d = centroid_squared_norms_[c]
+			               - 2.0 * row_dot(q.data(), centroids_.data() + c * dimension_, dimension_);
+			order.push_back({c, d});
+		}
+		probes = std::min(probes, order.size());
+		std::partial_sort(order.begin(),
+		                  order.begin() + static_cast<std::ptrdiff_t>(probes),
+		                  order.end(),
+		                  nearer);
+
+		auto best = std::vector<neighbour>();
+		best.reserve(k + 1);
+		for (auto p = std::size_t{0}; p < probes; ++p) {
+			for (auto const i : lists_[order[p].index]) {
+				consider(q, q_squared_norm, i, k, best);
+			}
+		}
+		return finish(std::move(best));
+	}
+
+	auto knn_index::prepare_query(euclidean_vector const& query) const -> std::vector<double> {
+		if (query.dimension_ != dimension_) {
+			detail::throw_dimension_error(query.dimension_, dimension_);
+		}
+		auto q = std::vector<double>(query.magnitude_.get(), query.magnitude_.get() + dimension_);
+		if (metric_ == distance_metric::cosine) {
+			auto const norm = std::sqrt(row_dot(q.data(), q.data(), dimension_));
+			if (norm == 0.0) {
+				throw euclidean_vector_error("euclidean_vector with zero euclidean normal has no "
+				                             "cosine distance");
+			}
+			std::transform(q.begin(), q.end(), q.begin(), [norm](double n) { return n / norm; });
+		}
+		return q;
+	}
+
+	auto knn_index::consider(std::vector<double> const& query,
+	                         double query_squared_norm,
+	                         std::size_t i,
+	                         std::size_t k,
+	                         std::vector<neighbour>& best) const -> void {
+		if (k == 0) {
+			return;
+		}
+		auto const product = row_dot(query.data(), row(i), dimension_);
+		// l2 keeps squared distances until finish, cosine rows are already normalised
+		auto const distance =
+		   metric_ == distance_metric::l2
+		      ? std::max(0.0, query_squared_norm + squared_norms_[i] - 2.0 * product)
+		      : 1.0 - product;
+		auto const candidate = neighbour{i, distance};
+		if (best.size() < k) {
+			best.push_back(candidate);
+			std::push_heap(best.begin(), best.end(), nearer);
+		}
+		else if (nearer(candidate, best.front())) {
+			std::pop_heap(best.begin(), best.end(), nearer);
+			best.back() = candidate;
+			std::push_heap(best.begin(), best.end(), nearer);
+		}
+	}
+
+	auto knn_index::finish(std::vector<neighbour> best) const -> std::vector<neighbour> {
+		std::sort_heap(best.begin(), best.end(), nearer);
+		if (metric_ == distance_metric::l2) {
+			for (auto& n : best) {
+				n.distance = std::sqrt(n.distance);
+			}
+		}
+		return best;
+	}
+
+	quantised_vector::quantised_vector(euclidean_vector const& v, precision p)
+	: precision_(p)
+	, dimension_(v.dimension_) {
+		auto const first = v.magnitude_.get();
+		auto const last = first + dimension_;
+		switch (precision_) {
+		case precision::float32:
+			float32_.assign(first, last);
+			break;
+		case precision::bfloat16:
+			bfloat16_.reserve(dimension_);
+			std::transform(first, last, std::back_inserter(bfloat16_), [](double n) {
+				return to_bfloat16(static_cast<float>(n));
+			});
+			break;
+		case precision::int8: {
+			// a NaN or infinity would make the scale, or n / scale_, non-finite,
+			// and converting that to std::int8_t is undefined
+			if (not std::all_of(first, last, [](double n) { return std::isfinite(n); })) {
+				throw euclidean_vector_error("int8 quantisation needs finite components");
+			}
+			auto largest = 0.0;
+			std::for_each (first, last, [&largest](double n) { largest = std::max(largest, std::abs(n)); });
+			scale_ = largest / 127.0;
+			// 0 for a zero vector, or when largest is so small the division underflows
+			if (scale_ == 0.0) {
+				scale_ = largest == 0.0 ? 1.0 : std::numeric_limits<double>::denorm_min();
+			}
+			int8_.reserve(dimension_);
+			std::transform(first, last, std::back_inserter(int8_), [this](double n) {
+				return static_cast<std::int8_t>(std::clamp(std::round(n / scale_), -127.0, 127.0));
+			});
+			break;
+		}
+		}
+	}
+
+	template<typename F>
+	auto quantised_vector::visit(F f) const -> decltype(auto) {
+		switch (precision_) {
+		case precision::float32:
+			return f([this](std::size_t i) { return static_cast<double>(float32_[i]); });
+		case precision::bfloat16:
+			return f([this](std::size_t i) { return from_bfloat16(bfloat16_[i]); });
+		case precision::int8:
+			break;
+		}
+		return f([this](std::size_t i) { return scale_ * static_cast<double>(int8_[i]); });
+	}
+
+	quantised_vector::operator euclidean_vector() const {
+		auto v = euclidean_vector(static_cast<int>(dimension_));
+		visit([this, &v](auto decode) {
+			for (auto i = std::size_t{0}; i < dimension_; ++i) {
+				v.magnitude_[i] = decode(i);
+			}
+		});
+		return v;
+	}
+
+	auto quantised_vector::operator[](int index) const -> double {
+		assert(index >= 0 and index < static_cast<int>(dimension_));
+		return visit([index](auto decode) { return decode(static_cast<std::size_t>(index)); });
+	}
+
+	auto quantised_vector::storage_bytes() const noexcept -> std::size_t {
+		return float32_.size() * sizeof(float) + bfloat16_.size() * sizeof(std::uint16_t)
+		       + int8_.size() * sizeof(std::int8_t);
+	}
+
+	auto euclidean_norm(quantised_vector const& v) -> double {
+		if (v.precision_ == precision::int8) {
+			auto sum = std::int64_t{0};
+			for (auto const n : v.int8_) {
+				sum += static_cast<std::int64_t>(n) * n;
+			}
+			return v.scale_ * std::sqrt(static_cast<double>(sum));
+		}
+		return v.visit([&v](auto decode) {
+			auto sum = 0.0;
+			for (auto i = std::size_t{0}; i < v.dimension_; ++i) {
+				auto const n = decode(i);
+				sum += n * n;
+			}
+			return std::sqrt(sum);
+		});
+	}
+
+	auto dot(quantised_vector const& x, quantised_vector const& y) -> double {
+		if (x.dimension_ != y.dimension_) {
+			detail::throw_dimension_error(x.dimension_, y.dimension_);
+		}
+		if (x.precision_ == precision::int8 and y.precision_ == precision::int8) {
+			auto sum = std::int64_t{0};
+			for (auto i = std::size_t{0}; i < x.dimension_; ++i) {
+				sum += static_cast<std::int64_t>(x.int8_[i]) * y.int8_[i];
+			}
+			return x.scale_ * y.scale_ * static_cast<double>(sum);
+		}
+		return x.visit([&x, &y](auto decode_x) {
+			return y.visit([&x, &decode_x](auto decode_y) {
+				auto sum = 0.0;
+				for (auto i = std::size_t{0}; i < x.dimension_; ++i) {
+					sum += decode_x(i) * decode_y(i);
+				}
+				return sum;
+			});
+		});
+	}
+
+	auto dot(quantised_vector const& x, euclidean_vector const& y) -> double {
+		if (x.dimension_ != y.dimension_) {
+			detail::throw_dimension_error(x.dimension_, y.dimension_);
+		}
+		return x.visit([&x, &y](auto decode) {
+			auto sum = 0.0;
+			for (auto i = std::size_t{0}; i < x.dimension_; ++i) {
+				sum += decode(i) * y.magnitude_[i];
+			}
+			return sum;
+		});
+	}
+
+	auto dot(euclidean_vector const& x, quantised_vector const& y) -> double {
+		return dot(y, x);
+	}
+
+	fixed_point_vector::fixed_point_vector(const_euclidean_vector_view v) {
+		if (static_cast<std::size_t>(v.dimensions()) > max_dimension) {
+			throw euclidean_vector_error("fixed_point_vector supports at most 2^22 dimensions");
+		}
+		components_.reserve(static_cast<std::size_t>(v.dimensions()));
+		std::transform(v.data(),
+		               v.data() + v.dimensions(),
+		               std::back_inserter(components_),
+		               [](double n) {
+			               auto const units = std::round(std::ldexp(n, fraction_bits));
+			               // also rejects NaN
+			               if (not(std::abs(units) < static_cast<double>(fixed_point_limit))) {
+				               throw euclidean_vector_error("fixed_point_vector components must have "
+				                                            "magnitude below 2^20");
+			               }
+			               return static_cast<std::int64_t>(units);
+		               });
+	}
+
+	fixed_point_vector::operator euclidean_vector() const {
+		auto result = euclidean_vector(dimensions());
+		std::transform(components_.begin(), components_.end(), result.data(), [](std::int64_t n) {
+			return std::ldexp(static_cast<double>(n), -fraction_bits);
+		});
+		return result;
+	}
+
+	auto fixed_point_vector::operator[](int index) const -> double {
+		assert(index >= 0 and index < dimensions());
+		return std::ldexp(static_cast<double>(components_[static_cast<std::size_t>(index)]),
+		                  -fraction_bits);
+	}
+
+	auto fixed_point_vector::operator+=(fixed_point_vector const& rhs) -> fixed_point_vector& {
+		if (rhs.components_.size() != components_.size()) {
+			detail::throw_dimension_error(components_.size(), rhs.components_.size());
+		}
+		combine_fixed_point(components_, rhs.components_, std::plus<>());
+		return *this;
+	}
+
+	auto fixed_point_vector::operator-=(fixed_point_vector const& rhs) -> fixed_point_vector& {
+		if (rhs.components_.size() != components_.size()) {
+			detail::throw_dimension_error(components_.size(), rhs.components_.size());
+		}
+		combine_fixed_point(components_, rhs.components_, std::minus<>());
+		return *this;
+	}
+
+	auto dot(fixed_point_vector const& x, fixed_point_vector const& y) -> double {
+		if (x.components_.size() != y.components_.size()) {
+			detail::throw_dimension_error(x.components_.size(), y.components_.size());
+		}
+		auto const sum =
+		   fixed_point_dot(x.components_.data(), y.components_.data(), x.components_.size());
+		return std::ldexp(static_cast<double>(sum), -2 * fixed_point_vector::fraction_bits);
+	}
+
+	auto squared_euclidean_norm(fixed_point_vector const& v) -> double {
+		return dot(v, v);
+	}
+
+	auto euclidean_norm(fixed_point_vector const& v) -> double {
+		return std::sqrt(squared_euclidean_norm(v));
+	}
+
+	euclidean_matrix::euclidean_matrix(int rows, int columns, double value)
+	: rows_(static_cast<std::size_t>(rows))
+	, columns_(static_cast<std::size_t>(columns))
+	, data_(rows_ * columns_, value) {}
+
+	euclidean_matrix::euclidean_matrix(std::span<euclidean_vector const> rows)
+	: rows_(rows.size())
+	, columns_(rows.empty() ? 0 : static_cast<std::size_t>(rows.front().dimensions())) {
+		data_.reserve(rows_ * columns_);
+		for (auto const& r : rows) {
+			if (static_cast<std::size_t>(r.dimensions()) != columns_) {
+				detail::throw_dimension_error(static_cast<std::size_t>(r.dimensions()), columns_);
+			}
+			data_.insert(data_.end(), r.data(), r.data() + columns_);
+		}
+	}
+
+	auto operator*(euclidean_matrix const& m, const_euclidean_vector_view v) -> euclidean_vector {
+		auto const rows = static_cast<std::size_t>(m.rows());
+		auto const columns = static_cast<std::size_t>(m.columns());
+		if (static_cast<std::size_t>(v.dimensions()) != columns) {
+			detail::throw_dimension_error(columns, static_cast<std::size_t>(v.dimensions()));
+		}
+		auto result = euclidean_vector(m.rows());
+		auto const out = result.data();
+		auto const a = m.data();
+		auto const x = v.data();
+		auto const column_block = std::max(dot_block_bytes / sizeof(double), std::size_t{1});
+		auto const band = [out, a, x, columns, column_block](std::size_t first, std::size_t last) {
+			std::fill(out + first, out + last, 0.0);
+			for (auto kb = std::size_t{0}; kb < columns; kb += column_block) {
+				auto const k_end = std::min(kb + column_block, columns);
+				auto r = first;
+				for (; r + dot_tile <= last; r += dot_tile) {
+					auto const r0 = a + r * columns;
+					auto const r1 = r0 + columns;
+					auto const r2 = r1 + columns;
+					auto const r3 = r2 + columns;
+					auto acc0 = 0.0;
+					auto acc1 = 0.0;
+					auto acc2 = 0.0;
+					auto acc3 = 0.0;
+					for (auto k = kb; k < k_end; ++k) {
+						acc0 += r0[k] * x[k];
+						acc1 += r1[k] * x[k];
+						acc2 += r2[k] * x[k];
+						acc3 += r3[k] * x[k];
+					}
+					out[r] += acc0;
+					out[r + 1] += acc1;
+					out[r + 2] += acc2;
+					out[r + 3] += acc3;
+				}
+				for (; r < last; ++r) {
+					out[r] += row_dot(a + r * columns + kb, x + kb, k_end - kb);
+				}
+			}
+		};
+		for_each_band(rows, matrix_band, rows * columns, band);
+		return result;
+	}
+
+	auto transposed_product(euclidean_matrix const& m, const_euclidean_vector_view v)
+	   -> euclidean_vector {
+		auto const rows = static_cast<std::size_t>(m.rows());
+		auto const columns = static_cast<std::size_t>(m.columns());
+		if (static_cast<std::size_t>(v.dimensions()) != rows) {
+			detail::throw_dimension_error(rows, static_cast<std::size_t>(v.dimensions()));
+		}
+		auto result = euclidean_vector(m.columns());
+		auto const out = result.data();
+		auto const a = m.data();
+		auto const x = v.data();
+		// each task owns a block of columns and adds every row into it,
+		// so no partial results have to be combined
+		auto const band = [out, a, x, rows, columns](std::size_t first, std::size_t last) {
+			for (auto r = std::size_t{0}; r < rows; ++r) {
+				auto const alpha = x[r];
+				auto const y = a + r * columns;
+				for (auto c = first; c < last; ++c) {
+					out[c] = multiply_add(alpha, y[c], out[c]);
+				}
+			}
+		};
+		for_each_band(columns, combination_block, rows * columns, band);
+		return result;
+	}
+
+	auto transform_batch(euclidean_matrix const& m, std::span<euclidean_vector const> vectors)
+	   -> std::vector<euclidean_vector> {
+		auto const rows = static_cast<std::size_t>(m.rows());
+		auto const columns = static_cast<std::size_t>(m.columns());
+		for (auto const& v : vectors) {
+			if (static_cast<std::size_t>(v.dimensions()) != columns) {
+				detail::throw_dimension_error(columns, static_cast<std::size_t>(v.dimensions()));
+			}
+		}
+		auto result = std::vector<euclidean_vector>();
+		result.reserve(vectors.size());
+		auto outs = std::vector<double*>();
+		outs.reserve(vectors.size());
+		for (auto i = std::size_t{0}; i < vectors.size(); ++i) {
+			outs.push_back(result.emplace_back(m.rows()).data());
+		}
+		auto const a = m.data();
+		// vector tiles are the outer loop and the band's row tiles the inner one,
+		// so the 4 vectors stay in cache while the band is streamed past them
+		auto const band = [&vectors, &outs, a, columns](std::size_t first, std::size_t last) {
+			auto j = std::size_t{0};
+			for (; j + dot_tile <= vectors.size(); j += dot_tile) {
+				double const* v_rows[dot_tile] = {}; // NOLINT(modernize-avoid-c-arrays)
+				for (auto t = std::size_t{0}; t < dot_tile; ++t) {
+					v_rows[t] = vectors[j + t].data();
+				}
+				auto r = first;
+				for (; r + dot_tile <= last; r += dot_tile) {
+					double const* m_rows[dot_tile] = {}; // NOLINT(modernize-avoid-c-arrays)
+					for (auto t = std::size_t{0}; t < dot_tile; ++t) {
+						m_rows[t] = a + (r + t) * columns;
+					}
+					// tile[i][t] is row r + i of m against vector j + t
+					double tile[dot_tile][dot_tile] = {}; // NOLINT(modernize-avoid-c-arrays)
+					dot_kernel_4x4(m_rows, v_rows, columns, tile[0], dot_tile);
+					for (auto i = std::size_t{0}; i < dot_tile; ++i) {
+						for (auto t = std::size_t{0}; t < dot_tile; ++t) {
+							outs[j + t][r + i] = tile[i][t];
+						}
+					}
+				}
+				for (; r < last; ++r) {
+					for (auto t = std::size_t{0}; t < dot_tile; ++t) {
+						outs[j + t][r] = row_dot(a + r * columns, v_rows[t], columns);
+					}
+				}
+			}
+			for (; j < vectors.size(); ++j) {
+				for (auto r = first; r < last; ++r) {
+					outs[j][r] = row_dot(a + r * columns, vectors[j].data(), columns);
+				}
+			}
+		};
+		for_each_band(rows, matrix_band, rows * columns * vectors.size(), band);
+		return result;
+	}
+
+	// the clone copies the cached norms along with the components, so the
+	// mutating call that follows decides whether they stay valid
+	auto cow_euclidean_vector::mutate() -> euclidean_vector& {
+		if (vector_.use_count() > 1) {
+			vector_ = std::make_shared<euclidean_vector>(std::as_const(*vector_));
+		}
+		return *vector_;
+	}
+
+	auto cow_euclidean_vector::empty() noexcept -> std::shared_ptr<euclidean_vector> const& {
+		static auto const vector = std::make_shared<euclidean_vector>(0);
+		return vector;
+	}
 } // namespace comp6771
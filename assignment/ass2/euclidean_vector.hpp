@@ -2,17 +2,29 @@
 #define COMP6771_EUCLIDEAN_VECTOR_HPP
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <cstddef>
 #include <functional>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <list>
 #include <memory>
+#include <memory_resource>
 #include <numeric>
+#include <optional>
+#include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace comp6771 {
@@ -22,49 +34,104 @@ namespace comp6771 {
 		: std::runtime_error(what) {}
 	};
 
+	// raw kernels shared by euclidean_vector and its views
+	// large inputs are processed in parallel, see euclidean_vector.cpp
+	namespace detail {
+		// x += y
+		auto add(double* x, double const* y, std::size_t length) -> void;
+		// x -= y
+		auto subtract(double* x, double const* y, std::size_t length) -> void;
+		// x *= scalar
+		auto multiply(double* x, double scalar, std::size_t length) -> void;
+		// x /= divisor
+		auto divide(double* x, double divisor, std::size_t length) -> void;
+		// y = alpha * x + beta * y
+		auto axpby(double alpha, double const* x, double beta, double* y, std::size_t length) -> void;
+
+		auto dot(double const* x, double const* y, std::size_t length) -> double;
+		auto squared_norm(double const* x, std::size_t length) -> double;
+
+		// error paths, never inlined into the callers' hot loops
+		// the gnu:: attributes are only hints, compilers that do not know them ignore them
+		[[noreturn, gnu::cold, gnu::noinline]] auto throw_dimension_error(std::size_t x, std::size_t y)
+		   -> void;
+		[[noreturn, gnu::cold, gnu::noinline]] auto throw_index_error(int index) -> void;
+		[[noreturn, gnu::cold, gnu::noinline]] auto throw_division_by_zero() -> void;
+	} // namespace detail
+
+	template<typename T>
+	class basic_euclidean_vector_view;
+
+	class binary_reader;
+	class knn_index;
+	class quantised_vector;
+
 	class euclidean_vector {
 	public:
+		// storage comes from a std::pmr::memory_resource,
+		// the default resource unless a constructor is given one
+		// anything that allocates throws what the resource throws, e.g. std::bad_alloc
+		using allocator_type = std::pmr::polymorphic_allocator<>;
+
+		// magnitude_ is always aligned to a cache line
+		static constexpr auto alignment = std::size_t{64};
+
+		// returns the buffer to the resource it came from
+		struct buffer_deleter {
+			std::pmr::memory_resource* resource;
+			// number of doubles allocated
+			std::size_t size;
+
+			auto operator()(double* p) const noexcept -> void {
+				resource->deallocate(p, size * sizeof(double), alignment);
+			}
+		};
+
+		// ass2 spec requires we use double[]
+		// NOLINTNEXTLINE(modernize-avoid-c-arrays)
+		using buffer_type = std::unique_ptr<double[], buffer_deleter>;
+
 		// Default Constructor
-		euclidean_vector() noexcept {
+		euclidean_vector()
+		: euclidean_vector(allocator_type{}) {}
+
+		explicit euclidean_vector(allocator_type allocator) {
 			dimension_ = 1;
 			reset_norm();
-			// NOLINTNEXTLINE(modernize-avoid-c-arrays)
-			magnitude_ = std::make_unique<double[]>(1);
+			magnitude_ = allocate(1, allocator);
 			magnitude_[0] = 0.0;
 		}
 
 		// Single-argument Constructor
-		explicit euclidean_vector(int dimension) noexcept {
+		explicit euclidean_vector(int dimension, allocator_type allocator = {}) {
 			dimension_ = static_cast<size_t>(dimension);
 			reset_norm();
-			// NOLINTNEXTLINE(modernize-avoid-c-arrays)
-			magnitude_ = std::make_unique<double[]>(static_cast<size_t>(dimension));
+			magnitude_ = allocate(dimension_, allocator);
+			std::fill_n(magnitude_.get(), dimension_, 0.0);
 		}
 
 		// Constructor
-		euclidean_vector(int dimension, double default_mag) noexcept {
+		euclidean_vector(int dimension, double default_mag, allocator_type allocator = {}) {
 			dimension_ = static_cast<size_t>(dimension);
 			reset_norm();
-			// NOLINTNEXTLINE(modernize-avoid-c-arrays)
-			magnitude_ = std::make_unique<double[]>(static_cast<size_t>(dimension));
+			magnitude_ = allocate(dimension_, allocator);
 			std::fill_n(magnitude_.get(), dimension, default_mag);
 		}
 
 		// iter Constructor
 		euclidean_vector(std::vector<double>::const_iterator begin,
-		                 std::vector<double>::const_iterator end) noexcept {
+		                 std::vector<double>::const_iterator end,
+		                 allocator_type allocator = {}) {
 			auto length = std::distance(begin, end);
 			reset_norm();
 			if (begin == end) {
 				dimension_ = 1;
-				// NOLINTNEXTLINE(modernize-avoid-c-arrays)
-				magnitude_ = std::make_unique<double[]>(1);
+				magnitude_ = allocate(1, allocator);
 				magnitude_[0] = 0.0;
 			}
 			else {
 				dimension_ = static_cast<size_t>(length);
-				// NOLINTNEXTLINE(modernize-avoid-c-arrays)
-				magnitude_ = std::make_unique<double[]>(dimension_);
+				magnitude_ = allocate(dimension_, allocator);
 				std::copy(begin, end, magnitude_.get());
 			}
 		}
@@ -72,34 +139,48 @@ namespace comp6771 {
 		// initializer_list Constructor
 		// if empty initializer list empty,
 		// default constructor will be called
-		euclidean_vector(std::initializer_list<double> d_list) noexcept {
+		euclidean_vector(std::initializer_list<double> d_list, allocator_type allocator = {}) {
 			dimension_ = d_list.size();
 			reset_norm();
-			// NOLINTNEXTLINE(modernize-avoid-c-arrays)
-			magnitude_ = std::make_unique<double[]>(d_list.size());
+			magnitude_ = allocate(d_list.size(), allocator);
 			std::copy(d_list.begin(), d_list.end(), magnitude_.get());
 		}
 
 		// copy constructor
-		euclidean_vector(euclidean_vector const& orig) noexcept {
+		// like the std::pmr containers, a copy uses the default resource
+		// unless it is given one
+		euclidean_vector(euclidean_vector const& orig, allocator_type allocator = {}) {
 			this->dimension_ = orig.dimension_;
-			norm_ = orig.norm_;
-			// NOLINTNEXTLINE(modernize-avoid-c-arrays)
-			magnitude_ = std::make_unique<double[]>(this->dimension_);
+			copy_norm(orig);
+			magnitude_ = allocate(this->dimension_, allocator);
 			std::copy(orig.magnitude_.get(), orig.magnitude_.get() + orig.dimension_, magnitude_.get());
 		};
 
+		// copy of a contiguous range of doubles, e.g. a std::vector<double>
+		// unlike the iterator constructor an empty range gives a 0 dimension vector
+		explicit euclidean_vector(std::span<double const> values, allocator_type allocator = {}) {
+			dimension_ = values.size();
+			reset_norm();
+			magnitude_ = allocate(dimension_, allocator);
+			std::copy(values.begin(), values.end(), magnitude_.get());
+		}
+
+		// copy of the viewed components
+		explicit euclidean_vector(basic_euclidean_vector_view<double const> view,
+		                          allocator_type allocator = {});
+
 		// move constructor
+		// the buffer keeps the resource it was allocated from
 		euclidean_vector(euclidean_vector&& orig) noexcept {
 			this->dimension_ = 0;
-			reset_norm();
 			std::swap(this->dimension_, orig.dimension_);
-			std::swap(this->norm_, orig.norm_);
-			this->magnitude_ = std::move(orig.magnitude_);
+			copy_norm(orig);
+			orig.reset_norm();
+			this->magnitude_ = take_buffer(orig.magnitude_);
 		};
 
 		// copy assignment
-		auto operator=(euclidean_vector const&) noexcept -> euclidean_vector&;
+		auto operator=(euclidean_vector const&) -> euclidean_vector&;
 
 		// move assignment
 		auto operator=(euclidean_vector&&) noexcept -> euclidean_vector&;
@@ -113,10 +194,10 @@ namespace comp6771 {
 		auto operator[](int) const -> double;
 
 		// Unary plus
-		auto operator+() const noexcept -> euclidean_vector;
+		auto operator+() const -> euclidean_vector;
 
 		// Negation
-		auto operator-() const noexcept -> euclidean_vector;
+		auto operator-() const -> euclidean_vector;
 
 		// Compound Addition
 		auto operator+=(euclidean_vector const&) -> euclidean_vector&;
@@ -127,22 +208,66 @@ namespace comp6771 {
 		// Compound Devision
 		auto operator/=(double) -> euclidean_vector&;
 
+		// BLAS-1 style updates, one pass over memory with no temporaries
+		// this += alpha * x
+		auto axpy(double alpha, basic_euclidean_vector_view<double const> x) -> euclidean_vector&;
+		// this = alpha * x + beta * this
+		auto axpby(double alpha, basic_euclidean_vector_view<double const> x, double beta)
+		   -> euclidean_vector&;
+		// this = beta * this + x
+		auto scale_add(double beta, basic_euclidean_vector_view<double const> x) -> euclidean_vector&;
+
 		// std::vector type conversion
 		explicit operator std::vector<double>() const noexcept;
 
 		// std::list type conversion
 		explicit operator std::list<double>() const noexcept;
 
+		// copy the components into out, which must have dimensions() elements
+		auto copy_to(std::span<double> out) const -> void;
+
+		// replace the components with values
+		// the existing buffer is reused when it is large enough,
+		// a moved from vector gets a new one
+		auto assign(std::span<double const> values) -> euclidean_vector&;
+
+		// hand the buffer over to the caller, this vector is left with dimension 0
+		// the buffer holds dimensions() components and is freed by its deleter
+		[[nodiscard]] auto release() && noexcept -> buffer_type;
+
 		// member function at with copy
 		[[nodiscard]] auto at(int) const -> double;
 
 		// member function at with reference
 		[[nodiscard]] auto at(int) -> double&;
 
+		// write one component and keep the cached squared norm up to date in O(1)
+		// instead of dropping it like operator[] and at do
+		// the running sum is recomputed exactly every exact_norm_interval updates,
+		// or sooner if cancellation would make it inaccurate
+		auto set(int index, double value) -> void;
+
+		static constexpr auto exact_norm_interval = 1024;
+
 		[[nodiscard]] auto dimensions() const noexcept -> int {
 			return static_cast<int>(dimension_);
 		}
 
+		[[nodiscard]] auto get_allocator() const noexcept -> allocator_type {
+			return allocator_type(magnitude_.get_deleter().resource);
+		}
+
+		// raw access to the components
+		// like the non-const operator[], the non-const overload drops the cached norm
+		[[nodiscard]] auto data() noexcept -> double* {
+			reset_norm();
+			return magnitude_.get();
+		}
+
+		[[nodiscard]] auto data() const noexcept -> double const* {
+			return magnitude_.get();
+		}
+
 		// Friend function ==
 		friend auto operator==(euclidean_vector const& lhs, euclidean_vector const& rhs) -> bool {
 			if (lhs.dimensions() != rhs.dimensions()) {
@@ -162,15 +287,7 @@ namespace comp6771 {
 		friend auto operator+(euclidean_vector const& lhs, euclidean_vector const& rhs)
 		   -> euclidean_vector {
 			if (lhs.dimension_ != rhs.dimension_) {
-				auto x = lhs.dimension_;
-				auto y = rhs.dimension_;
-				std::stringstream error_stream;
-				error_stream << "Dimensions of LHS(";
-				error_stream << x;
-				error_stream << ") and RHS(";
-				error_stream << y;
-				error_stream << ") do not match";
-				throw euclidean_vector_error(error_stream.str());
+				detail::throw_dimension_error(lhs.dimension_, rhs.dimension_);
 			}
 			auto copy(lhs);
 			copy += rhs;
@@ -181,14 +298,7 @@ namespace comp6771 {
 		friend auto operator-(euclidean_vector const& lhs, euclidean_vector const& rhs)
 		   -> euclidean_vector {
 			if (lhs.dimension_ != rhs.dimension_) {
-				auto x = lhs.dimension_;
-				auto y = rhs.dimension_;
-				std::stringstream error_stream;
-				error_stream << "Dimensions of LHS(";
-				error_stream << x;
-				error_stream << ") and RHS(";
-				error_stream << y;
-				error_stream << ") do not match";
+				detail::throw_dimension_error(lhs.dimension_, rhs.dimension_);
 			}
 			auto copy(lhs);
 			copy -= rhs;
@@ -212,7 +322,7 @@ namespace comp6771 {
 		// Friend division
 		friend auto operator/(euclidean_vector const& lhs, double dividend) -> euclidean_vector {
 			if (dividend == 0.0) {
-				throw euclidean_vector_error("Invalid vector division by 0");
+				detail::throw_division_by_zero();
 			}
 			auto copy(lhs);
 			copy /= dividend;
@@ -220,60 +330,957 @@ namespace comp6771 {
 		}
 
 		// Friend <<
-		friend auto operator<<(std::ostream& os, euclidean_vector const& orig) -> std::ostream& {
-			std::stringstream error_stream;
-			error_stream << '[';
-			std::copy(orig.magnitude_.get(),
-			          orig.magnitude_.get() + orig.dimension_,
-			          std::ostream_iterator<double>(error_stream, " "));
-			if (orig.dimension_ != 0) {
-				// if dimension = 0, which means result is []
-				// then I do not need to trim the last space beacuse there is no space in between
-				// else, I need to trim the last space before ']'
-				error_stream.seekp(-1, std::ios_base::end);
-			}
-			error_stream << "]";
-			os << error_stream.str();
-			return os;
-		}
+		// prints [a b c], each component formatted like printf("%g")
+		// a field width set on os pads the whole vector with os.fill()
+		friend auto operator<<(std::ostream& os, euclidean_vector const& orig) -> std::ostream&;
+
+		// parse text written by operator<< into v, reusing v's buffer
+		friend auto from_string(std::string_view text, euclidean_vector& v) -> void;
 
 		// make norm and dot functions to be friend functions
 		// sp they can access the maganitude_
 		friend auto euclidean_norm(euclidean_vector const& v) -> double;
 
+		friend auto squared_euclidean_norm(euclidean_vector const& v) -> double;
+
 		friend auto dot(euclidean_vector const& x, euclidean_vector const& y) -> double;
 
+		friend auto dot(std::span<euclidean_vector const> xs, std::span<euclidean_vector const> ys)
+		   -> std::vector<double>;
+
+		friend auto dot(quantised_vector const& x, euclidean_vector const& y) -> double;
+
+		friend auto kmeans_step(std::span<euclidean_vector const> points,
+		                        std::span<euclidean_vector> centroids,
+		                        std::span<std::size_t> assignment) -> std::size_t;
+
+		friend class binary_reader;
+		friend class knn_index;
+		friend class quantised_vector;
+		template<typename T>
+		friend class basic_euclidean_vector_view;
+
 	private:
-		// ass2 spec requires we use double[]
-		// NOLINTNEXTLINE(modernize-avoid-c-arrays)
-		std::unique_ptr<double[]> magnitude_;
+		// uninitialised, 64-byte aligned storage for size doubles
+		static auto allocate(std::size_t size, allocator_type allocator) -> buffer_type {
+			auto const resource = allocator.resource();
+			auto const p = static_cast<double*>(resource->allocate(size * sizeof(double), alignment));
+			return buffer_type(p, buffer_deleter{resource, size});
+		}
+
+		// takes the buffer out of buffer, leaving it empty with no capacity
+		// but still tied to the same resource
+		static auto take_buffer(buffer_type& buffer) noexcept -> buffer_type {
+			auto const resource = buffer.get_deleter().resource;
+			return std::exchange(buffer, buffer_type(nullptr, buffer_deleter{resource, 0}));
+		}
+
+		// make room for size components without initialising them,
+		// the existing buffer is reused when it is large enough
+		auto resize_for_overwrite(std::size_t size) -> void {
+			if (size > capacity()) {
+				magnitude_ = allocate(size, get_allocator());
+			}
+			dimension_ = size;
+			reset_norm();
+		}
+
+		// number of doubles magnitude_ can hold, may be more than dimension_
+		// a moved from vector has no buffer and so no capacity
+		[[nodiscard]] auto capacity() const noexcept -> std::size_t {
+			return magnitude_ ? magnitude_.get_deleter().size : 0;
+		}
+
+		buffer_type magnitude_;
 		size_t dimension_;
 
 		// cached norm defined as a mutable private variable
 		// because norm is always >= 0
 		// if norm = -1, we need to calculate the norm
-		mutable double norm_ = -1;
+		// the caches are atomic so const vectors can be shared between threads,
+		// relaxed ordering is enough because every thread computes the same value
+		mutable std::atomic<double> norm_ = -1;
+		mutable std::atomic<double> squared_norm_ = -1;
+		// set() calls applied to squared_norm_ since it was last valid
+		int incremental_updates_ = 0;
 
 		auto reset_norm() -> void {
-			norm_ = -1;
+			norm_.store(-1, std::memory_order_relaxed);
+			squared_norm_.store(-1, std::memory_order_relaxed);
+			incremental_updates_ = 0;
+		}
+
+		auto copy_norm(euclidean_vector const& other) -> void {
+			norm_.store(other.norm_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			squared_norm_.store(other.squared_norm_.load(std::memory_order_relaxed),
+			                    std::memory_order_relaxed);
+			incremental_updates_ = other.incremental_updates_;
 		}
 
 		// helper function in copy and move assignment
 		auto swap(euclidean_vector& other) -> void {
 			std::swap(dimension_, other.dimension_);
 			std::swap(magnitude_, other.magnitude_);
-			std::swap(norm_, other.norm_);
+			auto const norm = norm_.load(std::memory_order_relaxed);
+			auto const squared_norm = squared_norm_.load(std::memory_order_relaxed);
+			auto const incremental_updates = incremental_updates_;
+			copy_norm(other);
+			other.norm_.store(norm, std::memory_order_relaxed);
+			other.squared_norm_.store(squared_norm, std::memory_order_relaxed);
+			other.incremental_updates_ = incremental_updates;
 		}
 	};
 
 	// Utility function norm
 	auto euclidean_norm(euclidean_vector const& v) -> double;
 
+	// Utility function squared norm
+	// cached alongside the norm, avoids the sqrt for distance comparisons
+	auto squared_euclidean_norm(euclidean_vector const& v) -> double;
+
 	// Utility function unit
 	auto unit(euclidean_vector const& v) -> euclidean_vector;
 
 	// Utility function dot
 	auto dot(euclidean_vector const& x, euclidean_vector const& y) -> double;
 
+	// Utility function batched dot
+	// returns a row-major xs.size() x ys.size() matrix
+	// where result[i * ys.size() + j] == dot(xs[i], ys[j])
+	auto dot(std::span<euclidean_vector const> xs, std::span<euclidean_vector const> ys)
+	   -> std::vector<double>;
+
+	// Utility function squared distance
+	// |a|^2 + |b|^2 - 2a.b with the cached squared norms, so no temporary is made
+	// the identity loses precision for nearly equal vectors, so the result is
+	// clamped at 0
+	auto squared_distance(euclidean_vector const& a, euclidean_vector const& b) -> double;
+
+	// Utility function pairwise squared distances
+	// row-major xs.size() x ys.size() matrix of squared_distance(xs[i], ys[j]),
+	// built on the batched dot
+	auto pairwise_squared_distances(std::span<euclidean_vector const> xs,
+	                                std::span<euclidean_vector const> ys) -> std::vector<double>;
+
+	// Utility function pairwise distances
+	// symmetric batch.size() x batch.size() matrix of euclidean distances
+	auto pairwise_distances(std::span<euclidean_vector const> batch) -> std::vector<double>;
+
+	// one iteration of Lloyd's k-means
+	// assigns every point to its nearest centroid, then moves each centroid to the
+	// mean of its points, a centroid with no points stays where it was
+	// assignment holds one cluster index per point and is updated in place,
+	// returns how many points changed cluster (0 means the clustering converged)
+	auto kmeans_step(std::span<euclidean_vector const> points,
+	                 std::span<euclidean_vector> centroids,
+	                 std::span<std::size_t> assignment) -> std::size_t;
+
+	// runs kmeans_step until no point changes cluster or max_iterations is reached
+	// returns the number of iterations run
+	auto kmeans(std::span<euclidean_vector const> points,
+	            std::span<euclidean_vector> centroids,
+	            std::span<std::size_t> assignment,
+	            int max_iterations = 100) -> int;
+
+	// non-owning view over dimension contiguous doubles owned by someone else
+	// (a euclidean_vector, a row of a matrix, a network buffer...)
+	// basic_euclidean_vector_view<double> also allows in-place compound operators
+	// a view of a euclidean_vector must not outlive it
+	// a mutable view of a euclidean_vector drops the owner's cached norm on every
+	// write, just like the owner's own non-const operator[] and data()
+	template<typename T>
+	class basic_euclidean_vector_view {
+		static_assert(std::is_same_v<std::remove_const_t<T>, double>);
+
+	public:
+		basic_euclidean_vector_view(T* data, std::size_t dimension) noexcept
+		: data_(data)
+		, dimension_(dimension) {}
+
+		explicit basic_euclidean_vector_view(std::span<T> data) noexcept
+		: data_(data.data())
+		, dimension_(data.size()) {}
+
+		// view of a whole euclidean_vector
+		basic_euclidean_vector_view(euclidean_vector& v) noexcept requires(!std::is_const_v<T>)
+		: data_(v.data())
+		, dimension_(static_cast<std::size_t>(v.dimensions()))
+		, owner_(&v) {}
+
+		basic_euclidean_vector_view(euclidean_vector const& v) noexcept requires std::is_const_v<T>
+		: data_(v.data())
+		, dimension_(static_cast<std::size_t>(v.dimensions())) {}
+
+		// a mutable view converts to a const one
+		template<typename U>
+		requires(std::is_const_v<T> and std::is_same_v<U, double>)
+		   basic_euclidean_vector_view(basic_euclidean_vector_view<U> other) noexcept
+		: data_(other.data_)
+		, dimension_(other.dimension_) {}
+
+		auto operator[](int index) const noexcept -> T& {
+			assert(index >= 0 and index < static_cast<int>(dimension_));
+			reset_owner_norm();
+			return data_[static_cast<std::size_t>(index)];
+		}
+
+		[[nodiscard]] auto at(int index) const -> T& {
+			if (index < 0 or index >= static_cast<int>(dimension_)) {
+				detail::throw_index_error(index);
+			}
+			reset_owner_norm();
+			return data_[static_cast<std::size_t>(index)];
+		}
+
+		[[nodiscard]] auto dimensions() const noexcept -> int {
+			return static_cast<int>(dimension_);
+		}
+
+		[[nodiscard]] auto data() const noexcept -> T* {
+			reset_owner_norm();
+			return data_;
+		}
+
+		// Compound Addition
+		auto operator+=(basic_euclidean_vector_view<double const> rhs)
+		   -> basic_euclidean_vector_view& requires(!std::is_const_v<T>) {
+			if (static_cast<std::size_t>(rhs.dimensions()) != dimension_) {
+				detail::throw_dimension_error(dimension_, static_cast<std::size_t>(rhs.dimensions()));
+			}
+			reset_owner_norm();
+			detail::add(data_, rhs.data(), dimension_);
+			return *this;
+		}
+
+		// Compound Substraction
+		auto operator-=(basic_euclidean_vector_view<double const> rhs)
+		   -> basic_euclidean_vector_view& requires(!std::is_const_v<T>) {
+			if (static_cast<std::size_t>(rhs.dimensions()) != dimension_) {
+				detail::throw_dimension_error(dimension_, static_cast<std::size_t>(rhs.dimensions()));
+			}
+			reset_owner_norm();
+			detail::subtract(data_, rhs.data(), dimension_);
+			return *this;
+		}
+
+		// Compound Multiplication
+		auto operator*=(double scalar) noexcept
+		   -> basic_euclidean_vector_view& requires(!std::is_const_v<T>) {
+			reset_owner_norm();
+			detail::multiply(data_, scalar, dimension_);
+			return *this;
+		}
+
+		// Compound Devision
+		auto operator/=(double dividend)
+		   -> basic_euclidean_vector_view& requires(!std::is_const_v<T>) {
+			if (dividend == 0.0) {
+				detail::throw_division_by_zero();
+			}
+			reset_owner_norm();
+			detail::divide(data_, dividend, dimension_);
+			return *this;
+		}
+
+	private:
+		template<typename U>
+		friend class basic_euclidean_vector_view;
+
+		T* data_;
+		std::size_t dimension_;
+		// the euclidean_vector viewed by a mutable view, if any
+		euclidean_vector* owner_ = nullptr;
+
+		auto reset_owner_norm() const noexcept -> void {
+			if constexpr (not std::is_const_v<T>) {
+				if (owner_ != nullptr) {
+					owner_->reset_norm();
+				}
+			}
+		}
+	};
+
+	using euclidean_vector_view = basic_euclidean_vector_view<double>;
+	using const_euclidean_vector_view = basic_euclidean_vector_view<double const>;
+
+	// read-only operations on views
+	// euclidean_vectors and mutable views convert to const_euclidean_vector_view,
+	// so these also cover mixed owning / non-owning calls
+	auto operator==(const_euclidean_vector_view lhs, const_euclidean_vector_view rhs) -> bool;
+
+	auto operator<<(std::ostream& os, const_euclidean_vector_view v) -> std::ostream&;
+
+	auto euclidean_norm(const_euclidean_vector_view v) -> double;
+
+	auto squared_euclidean_norm(const_euclidean_vector_view v) -> double;
+
+	auto unit(const_euclidean_vector_view v) -> euclidean_vector;
+
+	auto dot(const_euclidean_vector_view x, const_euclidean_vector_view y) -> double;
+
+	// how dot and the norms add up their terms
+	// fast is the chunked kernel: the chunking does not depend on the thread count,
+	// but the rounding depends on how the compiler vectorised the kernel
+	// compensated adds each product together with its exact rounding error, using
+	// Neumaier summation in index order, so the result is bit-identical on every
+	// IEEE-754 target provided the build does not enable -ffast-math or
+	// floating-point contraction
+	enum class summation { fast, compensated };
+
+	auto dot(const_euclidean_vector_view x, const_euclidean_vector_view y, summation mode) -> double;
+
+	auto squared_euclidean_norm(const_euclidean_vector_view v, summation mode) -> double;
+
+	auto euclidean_norm(const_euclidean_vector_view v, summation mode) -> double;
+
+	// hash of the components, consistent with operator== (0.0 and -0.0 hash alike)
+	// four independent lanes are mixed per step so the loop vectorises
+	auto hash_value(const_euclidean_vector_view v) noexcept -> std::size_t;
+
+	// component-wise closeness, like Python's math.isclose:
+	// |x[i] - y[i]| <= max(relative_tolerance * max(|x[i]|, |y[i]|), absolute_tolerance)
+	// an infinity is only close to itself, NaN is close to nothing
+	// vectors of different dimensions are never approximately equal
+	auto approx_equal(const_euclidean_vector_view x,
+	                  const_euclidean_vector_view y,
+	                  double relative_tolerance = 1e-9,
+	                  double absolute_tolerance = 0.0) -> bool;
+
+	// random-hyperplane locality-sensitive hash for bucketing near duplicates
+	// bit b of the signature is set when v lies on the positive side of plane b,
+	// so vectors at a small angle share most bits (each bit differs with
+	// probability angle / pi); the planes are generated from the seed, so the
+	// same (dimension, bits, seed) always gives the same signatures
+	class hyperplane_hasher {
+	public:
+		hyperplane_hasher(int dimension, int bits, std::uint64_t seed = 0);
+
+		auto operator()(const_euclidean_vector_view v) const -> std::uint64_t;
+
+		[[nodiscard]] auto dimensions() const noexcept -> int {
+			return static_cast<int>(dimension_);
+		}
+
+		[[nodiscard]] auto bits() const noexcept -> int {
+			return bits_;
+		}
+
+	private:
+		std::size_t dimension_;
+		int bits_;
+		// bits_ x dimension_ row-major normals
+		std::vector<double> planes_;
+	};
+
+	// opt-in variants without the dimension check, for callers that have already
+	// validated their shapes; a mismatch is only caught by assert in debug builds
+	namespace unchecked {
+		inline auto add(euclidean_vector_view x, const_euclidean_vector_view y) -> void {
+			assert(x.dimensions() == y.dimensions());
+			detail::add(x.data(), y.data(), static_cast<std::size_t>(x.dimensions()));
+		}
+
+		inline auto subtract(euclidean_vector_view x, const_euclidean_vector_view y) -> void {
+			assert(x.dimensions() == y.dimensions());
+			detail::subtract(x.data(), y.data(), static_cast<std::size_t>(x.dimensions()));
+		}
+
+		inline auto dot(const_euclidean_vector_view x, const_euclidean_vector_view y) -> double {
+			assert(x.dimensions() == y.dimensions());
+			return detail::dot(x.data(), y.data(), static_cast<std::size_t>(x.dimensions()));
+		}
+	} // namespace unchecked
+
+	// sum of coefficients[i] * vectors[i], computed block by block so each input
+	// is read once and the output block stays in cache
+	auto linear_combination(std::span<double const> coefficients,
+	                        std::span<euclidean_vector const> vectors) -> euclidean_vector;
+
+	// text format, identical to operator<<
+	// like std::to_chars, writes into [first, last) and returns the end of the text,
+	// or std::errc::value_too_large if it does not fit
+	auto to_chars(char* first, char* last, const_euclidean_vector_view v) -> std::to_chars_result;
+
+	auto to_string(const_euclidean_vector_view v) -> std::string;
+
+	// parse "[a b c]", throws euclidean_vector_error on malformed text
+	auto from_string(std::string_view text) -> euclidean_vector;
+
+	auto from_string(std::string_view text, euclidean_vector& v) -> void;
+
+	// sparse companion of euclidean_vector for vectors with few non-zeros
+	// non-zero components are stored as (index, value) pairs sorted by index,
+	// zeros are never stored, so they do not count towards densify_threshold
+	// once more than densify_threshold of the components are stored
+	// the vector switches to a dense euclidean_vector internally and stays dense
+	class sparse_euclidean_vector {
+	public:
+		static constexpr auto densify_threshold = 0.25;
+
+		// all zero
+		explicit sparse_euclidean_vector(int dimension);
+
+		// entries in any order, values of repeated indices are summed
+		sparse_euclidean_vector(int dimension, std::vector<std::pair<int, double>> entries);
+
+		// the non-zero components of v
+		explicit sparse_euclidean_vector(const_euclidean_vector_view v);
+
+		explicit operator euclidean_vector() const;
+
+		auto operator[](int) const -> double;
+
+		// set one component, inserting it if it is not stored yet
+		// and erasing it if it becomes zero
+		auto set(int index, double value) -> void;
+
+		auto operator+=(sparse_euclidean_vector const&) -> sparse_euclidean_vector&;
+		auto operator-=(sparse_euclidean_vector const&) -> sparse_euclidean_vector&;
+		auto operator*=(double) noexcept -> sparse_euclidean_vector&;
+		auto operator/=(double) -> sparse_euclidean_vector&;
+
+		[[nodiscard]] auto dimensions() const noexcept -> int {
+			return static_cast<int>(dimension_);
+		}
+
+		// number of non-zero components, dimensions() once dense
+		[[nodiscard]] auto non_zeros() const noexcept -> std::size_t {
+			return dense_ ? dimension_ : indices_.size();
+		}
+
+		[[nodiscard]] auto is_dense() const noexcept -> bool {
+			return dense_.has_value();
+		}
+
+		friend auto operator==(sparse_euclidean_vector const& lhs, sparse_euclidean_vector const& rhs)
+		   -> bool;
+
+		friend auto operator+(sparse_euclidean_vector const& lhs, sparse_euclidean_vector const& rhs)
+		   -> sparse_euclidean_vector {
+			auto copy(lhs);
+			copy += rhs;
+			return copy;
+		}
+
+		friend auto operator-(sparse_euclidean_vector const& lhs, sparse_euclidean_vector const& rhs)
+		   -> sparse_euclidean_vector {
+			auto copy(lhs);
+			copy -= rhs;
+			return copy;
+		}
+
+		friend auto operator*(sparse_euclidean_vector const& lhs, double scalar)
+		   -> sparse_euclidean_vector {
+			auto copy(lhs);
+			copy *= scalar;
+			return copy;
+		}
+
+		friend auto operator*(double scalar, sparse_euclidean_vector const& rhs)
+		   -> sparse_euclidean_vector {
+			auto copy(rhs);
+			copy *= scalar;
+			return copy;
+		}
+
+		friend auto operator/(sparse_euclidean_vector const& lhs, double dividend)
+		   -> sparse_euclidean_vector {
+			auto copy(lhs);
+			copy /= dividend;
+			return copy;
+		}
+
+		friend auto euclidean_norm(sparse_euclidean_vector const& v) -> double;
+
+		friend auto dot(sparse_euclidean_vector const& x, sparse_euclidean_vector const& y) -> double;
+
+		friend auto dot(sparse_euclidean_vector const& x, const_euclidean_vector_view y) -> double;
+
+	private:
+		std::size_t dimension_;
+		// sorted, a euclidean_vector dimension always fits in 32 bits
+		std::vector<std::uint32_t> indices_;
+		std::vector<double> values_;
+		// set once the vector has been densified, indices_ and values_ are then empty
+		std::optional<euclidean_vector> dense_;
+
+		// switch to dense storage if the fill passed densify_threshold
+		auto maybe_densify() -> void;
+
+		// erase stored components that became zero, e.g. by underflow
+		auto drop_zeros() noexcept -> void;
+
+		// this += sign * rhs
+		auto add(sparse_euclidean_vector const& rhs, double sign) -> void;
+	};
+
+	auto euclidean_norm(sparse_euclidean_vector const& v) -> double;
+
+	auto dot(sparse_euclidean_vector const& x, sparse_euclidean_vector const& y) -> double;
+
+	auto dot(sparse_euclidean_vector const& x, const_euclidean_vector_view y) -> double;
+
+	auto dot(const_euclidean_vector_view x, sparse_euclidean_vector const& y) -> double;
+
+	// binary format
+	// each vector is its dimension as a little-endian uint64
+	// followed by that many little-endian IEEE-754 doubles
+	// on little-endian hosts the components are read and written as one block
+
+	class binary_writer {
+	public:
+		explicit binary_writer(std::ostream& os) noexcept
+		: os_(&os) {}
+
+		auto write(const_euclidean_vector_view v) -> void;
+
+	private:
+		std::ostream* os_;
+	};
+
+	class binary_reader {
+	public:
+		explicit binary_reader(std::istream& is) noexcept
+		: is_(&is) {}
+
+		// read the next vector into v, reusing its buffer when it is large enough
+		// returns false at the end of the stream, throws if a vector is truncated
+		// or its dimension does not fit an int
+		// v is unchanged if that is found before reading the components, which is
+		// always the case for a seekable stream, and left with dimension 0 otherwise
+		auto read(euclidean_vector& v) -> bool;
+
+		auto read() -> std::optional<euclidean_vector>;
+
+	private:
+		std::istream* is_;
+	};
+
+	// reads vectors straight out of memory holding the binary format,
+	// e.g. a mmapped file, and returns views into it without copying
+	// the buffer must be 8-byte aligned and the host little-endian
+	class binary_buffer_reader {
+	public:
+		explicit binary_buffer_reader(std::span<std::byte const> buffer);
+
+		// the next vector, or std::nullopt at the end of the buffer
+		// throws if a vector is truncated or its dimension does not fit an int
+		auto next() -> std::optional<const_euclidean_vector_view>;
+
+	private:
+		std::span<std::byte const> buffer_;
+		std::size_t offset_ = 0;
+	};
+
+	enum class distance_metric { l2, cosine };
+
+	// k-nearest-neighbour index over a fixed collection of euclidean_vectors
+	// vectors are copied once into one contiguous row-major buffer
+	// search is exact brute force, search_approximate probes an IVF index
+	// (k-means coarse quantiser) that has to be built with build_ivf first
+	class knn_index {
+	public:
+		struct neighbour {
+			std::size_t index;
+			double distance;
+		};
+
+		explicit knn_index(std::span<euclidean_vector const> vectors,
+		                   distance_metric metric = distance_metric::l2);
+
+		// cluster the rows into `lists` inverted lists with at most `iterations` rounds
+		// of k-means, throws if lists is not in [1, size()] or iterations is negative
+		auto build_ivf(std::size_t lists, int iterations = 10) -> void;
+
+		// exact top-k, nearest first
+		[[nodiscard]] auto search(euclidean_vector const& query, std::size_t k) const
+		   -> std::vector<neighbour>;
+
+		// approximate top-k, only rows in the `probes` closest lists are scanned
+		[[nodiscard]] auto search_approximate(euclidean_vector const& query,
+		                                      std::size_t k,
+		                                      std::size_t probes) const -> std::vector<neighbour>;
+
+		[[nodiscard]] auto size() const noexcept -> std::size_t {
+			return size_;
+		}
+
+		[[nodiscard]] auto dimensions() const noexcept -> int {
+			return static_cast<int>(dimension_);
+		}
+
+		[[nodiscard]] auto metric() const noexcept -> distance_metric {
+			return metric_;
+		}
+
+	private:
+		distance_metric metric_;
+		std::size_t dimension_;
+		std::size_t size_;
+		// row-major, rows are normalised when metric_ is cosine
+		std::vector<double> data_;
+		std::vector<double> squared_norms_;
+
+		// IVF index, empty until build_ivf is called
+		std::vector<double> centroids_;
+		std::vector<double> centroid_squared_norms_;
+		std::vector<std::vector<std::size_t>> lists_;
+
+		[[nodiscard]] auto row(std::size_t i) const noexcept -> double const* {
+			return data_.data() + i * dimension_;
+		}
+
+		// query as a raw buffer, normalised for cosine
+		[[nodiscard]] auto prepare_query(euclidean_vector const& query) const -> std::vector<double>;
+
+		// score row i against the query and keep it in the max-heap `best`
+		// if it is one of the k nearest seen so far
+		auto consider(std::vector<double> const& query,
+		              double query_squared_norm,
+		              std::size_t i,
+		              std::size_t k,
+		              std::vector<neighbour>& best) const -> void;
+
+		// turn the heap into the final nearest-first answer
+		[[nodiscard]] auto finish(std::vector<neighbour> best) const -> std::vector<neighbour>;
+	};
+
+	// storage encodings for quantised_vector
+	// int8 is symmetric with one scale per vector and needs finite components
+	enum class precision { float32, bfloat16, int8 };
+
+	// read-only companion of euclidean_vector stored in a narrower type
+	// dot and norm decode on the fly and accumulate in double
+	// (int8 * int8 products are accumulated exactly in integers)
+	class quantised_vector {
+	public:
+		quantised_vector(euclidean_vector const& v, precision p);
+
+		// decode back to the double based type
+		explicit operator euclidean_vector() const;
+
+		// decoded component
+		auto operator[](int) const -> double;
+
+		[[nodiscard]] auto dimensions() const noexcept -> int {
+			return static_cast<int>(dimension_);
+		}
+
+		[[nodiscard]] auto encoding() const noexcept -> precision {
+			return precision_;
+		}
+
+		// bytes used by the components
+		[[nodiscard]] auto storage_bytes() const noexcept -> std::size_t;
+
+		friend auto euclidean_norm(quantised_vector const& v) -> double;
+
+		friend auto dot(quantised_vector const& x, quantised_vector const& y) -> double;
+
+		friend auto dot(quantised_vector const& x, euclidean_vector const& y) -> double;
+
+	private:
+		precision precision_;
+		size_t dimension_;
+		// int8 components are value / scale_
+		double scale_ = 1.0;
+		// only the vector matching precision_ is populated
+		std::vector<float> float32_;
+		std::vector<std::uint16_t> bfloat16_;
+		std::vector<std::int8_t> int8_;
+
+		// calls f(decode) where decode(i) returns component i as a double
+		template<typename F>
+		auto visit(F f) const -> decltype(auto);
+	};
+
+	// Utility function norm
+	auto euclidean_norm(quantised_vector const& v) -> double;
+
+	// Utility function dot
+	auto dot(quantised_vector const& x, quantised_vector const& y) -> double;
+
+	auto dot(quantised_vector const& x, euclidean_vector const& y) -> double;
+
+	auto dot(euclidean_vector const& x, quantised_vector const& y) -> double;
+
+	// euclidean_vector stored as 64-bit integers counting units of 2^-fraction_bits
+	// components are rounded to the nearest unit on construction and must have
+	// magnitude below 2^integer_bits
+	// dot and norms accumulate the products in 128-bit integers, so they are exact
+	// and do not depend on the order of summation, the thread count or the target
+	// the accumulator is the GCC/Clang __int128 extension, so the library needs one of
+	// those compilers on a 64-bit target, see euclidean_vector.cpp
+	class fixed_point_vector {
+	public:
+		static constexpr auto fraction_bits = 32;
+		static constexpr auto integer_bits = 20;
+		// the largest dimension whose dot cannot overflow the 128-bit accumulator
+		static constexpr auto max_dimension = std::size_t{1} << 22U;
+
+		explicit fixed_point_vector(const_euclidean_vector_view v);
+
+		// back to the double based type, exact since every unit is representable
+		explicit operator euclidean_vector() const;
+
+		// component as a double
+		auto operator[](int) const -> double;
+
+		[[nodiscard]] auto dimensions() const noexcept -> int {
+			return static_cast<int>(components_.size());
+		}
+
+		// components in units of 2^-fraction_bits
+		[[nodiscard]] auto raw() const noexcept -> std::span<std::int64_t const> {
+			return components_;
+		}
+
+		// exact, throw if a component leaves the representable range
+		auto operator+=(fixed_point_vector const&) -> fixed_point_vector&;
+		auto operator-=(fixed_point_vector const&) -> fixed_point_vector&;
+
+		friend auto operator==(fixed_point_vector const&, fixed_point_vector const&) -> bool = default;
+
+		friend auto dot(fixed_point_vector const& x, fixed_point_vector const& y) -> double;
+
+	private:
+		std::vector<std::int64_t> components_;
+	};
+
+	// Utility function dot
+	// the exact dot rounded once to double
+	auto dot(fixed_point_vector const& x, fixed_point_vector const& y) -> double;
+
+	// Utility function squared norm
+	auto squared_euclidean_norm(fixed_point_vector const& v) -> double;
+
+	// Utility function norm
+	auto euclidean_norm(fixed_point_vector const& v) -> double;
+
+	// dense matrix in one contiguous row-major buffer
+	// each row has the layout of a euclidean_vector and is exposed as a view
+	class euclidean_matrix {
+	public:
+		euclidean_matrix(int rows, int columns, double value = 0.0);
+
+		// copies the vectors in as rows, they must all have the same dimension
+		explicit euclidean_matrix(std::span<euclidean_vector const> rows);
+
+		auto operator()(int row, int column) noexcept -> double& {
+			assert(row >= 0 and static_cast<std::size_t>(row) < rows_);
+			assert(column >= 0 and static_cast<std::size_t>(column) < columns_);
+			return data_[static_cast<std::size_t>(row) * columns_ + static_cast<std::size_t>(column)];
+		}
+
+		auto operator()(int row, int column) const noexcept -> double {
+			assert(row >= 0 and static_cast<std::size_t>(row) < rows_);
+			assert(column >= 0 and static_cast<std::size_t>(column) < columns_);
+			return data_[static_cast<std::size_t>(row) * columns_ + static_cast<std::size_t>(column)];
+		}
+
+		[[nodiscard]] auto row(int index) noexcept -> euclidean_vector_view {
+			assert(index >= 0 and static_cast<std::size_t>(index) < rows_);
+			return {data_.data() + static_cast<std::size_t>(index) * columns_, columns_};
+		}
+
+		[[nodiscard]] auto row(int index) const noexcept -> const_euclidean_vector_view {
+			assert(index >= 0 and static_cast<std::size_t>(index) < rows_);
+			return {data_.data() + static_cast<std::size_t>(index) * columns_, columns_};
+		}
+
+		[[nodiscard]] auto rows() const noexcept -> int {
+			return static_cast<int>(rows_);
+		}
+
+		[[nodiscard]] auto columns() const noexcept -> int {
+			return static_cast<int>(columns_);
+		}
+
+		[[nodiscard]] auto data() noexcept -> double* {
+			return data_.data();
+		}
+
+		[[nodiscard]] auto data() const noexcept -> double const* {
+			return data_.data();
+		}
+
+		friend auto operator==(euclidean_matrix const&, euclidean_matrix const&) -> bool = default;
+
+	private:
+		std::size_t rows_;
+		std::size_t columns_;
+		std::vector<double> data_;
+	};
+
+	// matrix-vector product m * v
+	// rows are processed in bands, in parallel for large matrices, and each band
+	// walks v in cache sized blocks with four rows sharing every load of v
+	auto operator*(euclidean_matrix const& m, const_euclidean_vector_view v) -> euclidean_vector;
+
+	// transpose(m) * v without forming the transpose, the rows of m are
+	// combined with the components of v as coefficients
+	auto transposed_product(euclidean_matrix const& m, const_euclidean_vector_view v)
+	   -> euclidean_vector;
+
+	// m * v for every v, using the batched dot's 4 x 4 tiles
+	// the rows are split into bands, and within a band each tile of 4 vectors is
+	// multiplied against every tile of 4 rows, so a band is read from memory once
+	// and then from cache for each tile of vectors, instead of once per vector
+	auto transform_batch(euclidean_matrix const& m, std::span<euclidean_vector const> vectors)
+	   -> std::vector<euclidean_vector>;
+
+	// euclidean_vector behind a shared, reference-counted buffer
+	// copies share the buffer (and its cached norms) and the buffer is cloned
+	// on the first mutating call made while it is shared, so read-mostly code
+	// can pass these by value without copying the components
+	// once operator[] or at() has handed out a double&, the buffer is never shared
+	// again: later copies clone it, so writes through the reference stay private
+	// not thread-safe: the use count is checked without synchronisation, so copies
+	// sharing a buffer must not be used from different threads while any of them
+	// is mutated
+	class cow_euclidean_vector {
+	public:
+		explicit cow_euclidean_vector(int dimensions = 1)
+		: vector_(std::make_shared<euclidean_vector>(dimensions)) {}
+
+		explicit cow_euclidean_vector(euclidean_vector v)
+		: vector_(std::make_shared<euclidean_vector>(std::move(v))) {}
+
+		cow_euclidean_vector(cow_euclidean_vector const& orig)
+		: vector_(orig.unshareable_ ? std::make_shared<euclidean_vector>(orig.get()) : orig.vector_) {}
+
+		// a moved from vector has dimension 0, like a moved from euclidean_vector
+		cow_euclidean_vector(cow_euclidean_vector&& orig) noexcept
+		: vector_(std::exchange(orig.vector_, empty()))
+		, unshareable_(std::exchange(orig.unshareable_, false)) {}
+
+		auto operator=(cow_euclidean_vector const& orig) -> cow_euclidean_vector& {
+			if (this != &orig) {
+				auto copy = cow_euclidean_vector(orig);
+				*this = std::move(copy);
+			}
+			return *this;
+		}
+
+		auto operator=(cow_euclidean_vector&& orig) noexcept -> cow_euclidean_vector& {
+			if (this != &orig) {
+				vector_ = std::exchange(orig.vector_, empty());
+				unshareable_ = std::exchange(orig.unshareable_, false);
+			}
+			return *this;
+		}
+
+		~cow_euclidean_vector() = default;
+
+		// read access never clones
+		auto operator[](int index) const -> double {
+			return std::as_const(*vector_)[index];
+		}
+
+		[[nodiscard]] auto at(int index) const -> double {
+			return std::as_const(*vector_).at(index);
+		}
+
+		// the vector the buffer holds, for every euclidean_vector function
+		[[nodiscard]] auto get() const noexcept -> euclidean_vector const& {
+			return *vector_;
+		}
+
+		operator const_euclidean_vector_view() const noexcept {
+			return *vector_;
+		}
+
+		[[nodiscard]] auto dimensions() const noexcept -> int {
+			return vector_->dimensions();
+		}
+
+		// true while other copies still use this buffer
+		[[nodiscard]] auto shared() const noexcept -> bool {
+			return vector_.use_count() > 1;
+		}
+
+		// write access clones a shared buffer first
+		// and stops this buffer from being shared, see above
+		auto operator[](int index) -> double& {
+			auto& v = mutate();
+			unshareable_ = true;
+			return v[index];
+		}
+
+		[[nodiscard]] auto at(int index) -> double& {
+			auto& component = mutate().at(index);
+			unshareable_ = true;
+			return component;
+		}
+
+		auto operator+=(cow_euclidean_vector const& rhs) -> cow_euclidean_vector& {
+			mutate() += rhs.get();
+			return *this;
+		}
+
+		auto operator-=(cow_euclidean_vector const& rhs) -> cow_euclidean_vector& {
+			mutate() -= rhs.get();
+			return *this;
+		}
+
+		auto operator*=(double scalar) -> cow_euclidean_vector& {
+			mutate() *= scalar;
+			return *this;
+		}
+
+		auto operator/=(double dividend) -> cow_euclidean_vector& {
+			mutate() /= dividend;
+			return *this;
+		}
+
+		// the binary operators build the result straight from both operands
+		// rather than sharing lhs and then cloning it
+		friend auto operator+(cow_euclidean_vector const& lhs, cow_euclidean_vector const& rhs)
+		   -> cow_euclidean_vector {
+			return cow_euclidean_vector(lhs.get() + rhs.get());
+		}
+
+		friend auto operator-(cow_euclidean_vector const& lhs, cow_euclidean_vector const& rhs)
+		   -> cow_euclidean_vector {
+			return cow_euclidean_vector(lhs.get() - rhs.get());
+		}
+
+		friend auto operator*(cow_euclidean_vector const& lhs, double scalar) -> cow_euclidean_vector {
+			return cow_euclidean_vector(lhs.get() * scalar);
+		}
+
+		friend auto operator*(double scalar, cow_euclidean_vector const& rhs) -> cow_euclidean_vector {
+			return cow_euclidean_vector(scalar * rhs.get());
+		}
+
+		friend auto operator/(cow_euclidean_vector const& lhs, double dividend)
+		   -> cow_euclidean_vector {
+			return cow_euclidean_vector(lhs.get() / dividend);
+		}
+
+		friend auto operator==(cow_euclidean_vector const& lhs, cow_euclidean_vector const& rhs)
+		   -> bool {
+			return lhs.get() == rhs.get();
+		}
+
+	private:
+		std::shared_ptr<euclidean_vector> vector_;
+		// set once a double& into vector_ may still be live
+		bool unshareable_ = false;
+
+		// the vector, cloned first if another copy shares it
+		auto mutate() -> euclidean_vector&;
+
+		// one dimension 0 vector shared by every moved from object, it is always
+		// shared, so mutating a moved from object clones it first
+		static auto empty() noexcept -> std::shared_ptr<euclidean_vector> const&;
+	};
 } // namespace comp6771
+
+template<>
+struct std::hash<comp6771::euclidean_vector> {
+	auto operator()(comp6771::euclidean_vector const& v) const noexcept -> std::size_t {
+		return comp6771::hash_value(v);
+	}
+};
 #endif // COMP6771_EUCLIDEAN_VECTOR_HPP
@@ -0,0 +1,293 @@
+// microbenchmarks for euclidean_vector
+// usage: euclidean_vector_bench [max_dimension] > results.json
+// every operation runs at dimensions 1, 10, 100... up to max_dimension (default 10^7)
+// and is repeated until it has run for at least min_time, then reported as
+// nanoseconds per operation, GB/s of vector data touched and allocations per
+// operation, counted through the default std::pmr::memory_resource
+// (the std::vector and std::list conversions use std::allocator and count as 0)
+// the knn section reports queries per second and recall@k of search_approximate
+// against the exact search
+#include "comp6771/euclidean_vector.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <memory_resource>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+	// forwards to upstream and counts what passes through
+	class counting_resource : public std::pmr::memory_resource {
+	public:
+		explicit counting_resource(std::pmr::memory_resource* upstream) noexcept
+		: upstream_(upstream) {}
+
+		[[nodiscard]] auto allocations() const noexcept -> std::size_t {
+			return allocations_.load(std::memory_order_relaxed);
+		}
+
+	private:
+		std::pmr::memory_resource* upstream_;
+		std::atomic<std::size_t> allocations_ = 0;
+
+		auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override {
+			allocations_.fetch_add(1, std::memory_order_relaxed);
+			return upstream_->allocate(bytes, alignment);
+		}
+
+		auto do_deallocate(void* p, std::size_t bytes, std::size_t alignment) -> void override {
+			upstream_->deallocate(p, bytes, alignment);
+		}
+
+		[[nodiscard]] auto do_is_equal(std::pmr::memory_resource const& other) const noexcept
+		   -> bool override {
+			return this == &other;
+		}
+	};
+
+	constexpr auto min_time = std::chrono::milliseconds(50);
+
+	// results are added here so the compiler cannot drop the work
+	volatile auto sink = 0.0;
+
+	struct result {
+		std::string name;
+		int dimension;
+		std::size_t iterations;
+		double ns_per_op;
+		double gb_per_s;
+		double allocations_per_op;
+	};
+
+	// runs op until min_time has passed, doubling the batch each round
+	// bytes is how much vector data one op reads and writes
+	template<typename Op>
+	auto measure(counting_resource const& counter,
+	             std::string name,
+	             int dimension,
+	             std::size_t bytes,
+	             Op op) -> result {
+		using clock = std::chrono::steady_clock;
+		op();
+		auto iterations = std::size_t{1};
+		for (;;) {
+			auto const allocations = counter.allocations();
+			auto const start = clock::now();
+			for (auto i = std::size_t{0}; i < iterations; ++i) {
+				op();
+			}
+			auto const elapsed = clock::now() - start;
+			if (elapsed >= min_time) {
+				auto const ns = std::chrono::duration<double, std::nano>(elapsed).count()
+				                / static_cast<double>(iterations);
+				return {std::move(name),
+				        dimension,
+				        iterations,
+				        ns,
+				        static_cast<double>(bytes) / ns,
+				        static_cast<double>(counter.allocations() - allocations)
+				           / static_cast<double>(iterations)};
+			}
+			iterations *= 2;
+		}
+	}
+
+	auto random_vector(int dimension, std::mt19937_64& engine) -> comp6771::euclidean_vector {
+		auto distribution = std::normal_distribution<double>();
+		auto v = comp6771::euclidean_vector(dimension);
+		for (auto i = 0; i < dimension; ++i) {
+			v[i] = distribution(engine);
+		}
+		return v;
+	}
+
+	auto run_operations(counting_resource const& counter, int dimension, std::vector<result>& results)
+	   -> void {
+		auto engine = std::mt19937_64(dimension);
+		auto const x = random_vector(dimension, engine);
+		auto const y = random_vector(dimension, engine);
+		auto z = x;
+		auto const size = static_cast<std::size_t>(dimension) * sizeof(double);
+		auto const add = [&](std::string name, std::size_t bytes, auto op) {
+			results.push_back(measure(counter, std::move(name), dimension, bytes, op));
+		};
+
+		add("construct", size, [&] {
+			auto v = comp6771::euclidean_vector(dimension, 1.0);
+			sink = sink + v[0];
+		});
+		add("copy_construct", 2 * size, [&] {
+			auto v = x;
+			sink = sink + v[0];
+		});
+		// same dimension, so the buffer is reused and nothing is allocated
+		add("copy_assign", 2 * size, [&] {
+			z = x;
+			sink = sink + std::as_const(z)[0];
+		});
+		// each op moves z out and back again
+		add("move_construct", 0, [&] {
+			auto v = std::move(z);
+			z = std::move(v);
+		});
+		auto w = comp6771::euclidean_vector(0);
+		add("move_assign", 0, [&] {
+			w = std::move(z);
+			z = std::move(w);
+		});
+		z = x;
+
+		add("operator+", 3 * size, [&] { sink = sink + (x + y)[0]; });
+		add("operator-", 3 * size, [&] { sink = sink + (x - y)[0]; });
+		add("operator*", 2 * size, [&] { sink = sink + (x * 1.5)[0]; });
+		add("operator/", 2 * size, [&] { sink = sink + (x / 1.5)[0]; });
+		add("unary_minus", 2 * size, [&] { sink = sink + (-x)[0]; });
+		add("operator+=", 3 * size, [&] { z += y; });
+		add("operator-=", 3 * size, [&] { z -= y; });
+		add("operator*=", 2 * size, [&] { z *= 1.0; });
+		add("operator/=", 2 * size, [&] { z /= 1.0; });
+		add("unchecked_add", 3 * size, [&] { comp6771::unchecked::add(z, y); });
+		add("dot", 2 * size, [&] { sink = sink + comp6771::dot(x, y); });
+		add("unchecked_dot", 2 * size, [&] { sink = sink + comp6771::unchecked::dot(x, y); });
+		add("dot_compensated", 2 * size, [&] {
+			sink = sink + comp6771::dot(x, y, comp6771::summation::compensated);
+		});
+		if (static_cast<std::size_t>(dimension) <= comp6771::fixed_point_vector::max_dimension) {
+			auto const fx = comp6771::fixed_point_vector(x);
+			auto const fy = comp6771::fixed_point_vector(y);
+			add("fixed_point_dot", 2 * size, [&] { sink = sink + comp6771::dot(fx, fy); });
+		}
+		add("euclidean_norm_cached", 0, [&] { sink = sink + comp6771::euclidean_norm(x); });
+		// the write through operator[] drops the cached norm
+		add("euclidean_norm_uncached", size, [&] {
+			z[0] = 1.0;
+			sink = sink + comp6771::euclidean_norm(z);
+		});
+		add("unit", 2 * size, [&] { sink = sink + comp6771::unit(x)[0]; });
+		add("to_std_vector", 2 * size, [&] {
+			sink = sink + static_cast<std::vector<double>>(x).front();
+		});
+		add("to_std_list", 2 * size, [&] { sink = sink + static_cast<std::list<double>>(x).front(); });
+		auto os = std::ostringstream();
+		add("operator<<", size, [&] {
+			os.str("");
+			os << x;
+			sink = sink + static_cast<double>(os.tellp());
+		});
+	}
+
+	struct knn_result {
+		std::string mode;
+		std::size_t probes;
+		double qps;
+		double recall;
+	};
+
+	// clustered points, so the IVF lists mean something
+	auto run_knn() -> std::vector<knn_result> {
+		constexpr auto points = 20000;
+		constexpr auto dimension = 64;
+		constexpr auto clusters = 100;
+		constexpr auto queries = 200;
+		constexpr auto k = std::size_t{10};
+		constexpr auto lists = std::size_t{128};
+
+		auto engine = std::mt19937_64(42);
+		auto centres = std::vector<comp6771::euclidean_vector>();
+		for (auto c = 0; c < clusters; ++c) {
+			centres.push_back(random_vector(dimension, engine) * 4.0);
+		}
+		auto vectors = std::vector<comp6771::euclidean_vector>();
+		for (auto i = 0; i < points; ++i) {
+			vectors.push_back(centres[static_cast<std::size_t>(i % clusters)]
+			                  + random_vector(dimension, engine));
+		}
+		auto query_vectors = std::vector<comp6771::euclidean_vector>();
+		for (auto q = 0; q < queries; ++q) {
+			query_vectors.push_back(centres[static_cast<std::size_t>(q % clusters)]
+			                        + random_vector(dimension, engine));
+		}
+
+		auto index = comp6771::knn_index(vectors);
+		index.build_ivf(lists);
+
+		using clock = std::chrono::steady_clock;
+		auto exact = std::vector<std::vector<comp6771::knn_index::neighbour>>();
+		auto const start = clock::now();
+		for (auto const& q : query_vectors) {
+			exact.push_back(index.search(q, k));
+		}
+		auto const seconds = std::chrono::duration<double>(clock::now() - start).count();
+		auto results = std::vector<knn_result>{{"exact", lists, queries / seconds, 1.0}};
+
+		for (auto const probes : {std::size_t{1}, std::size_t{4}, std::size_t{16}}) {
+			auto found = std::size_t{0};
+			auto const first = clock::now();
+			for (auto q = std::size_t{0}; q < query_vectors.size(); ++q) {
+				auto const approximate = index.search_approximate(query_vectors[q], k, probes);
+				for (auto const& n : approximate) {
+					found += static_cast<std::size_t>(
+					   std::any_of(exact[q].begin(), exact[q].end(), [&n](auto const& e) {
+						   return e.index == n.index;
+					   }));
+				}
+			}
+			auto const elapsed = std::chrono::duration<double>(clock::now() - first).count();
+			results.push_back({"ivf",
+			                   probes,
+			                   queries / elapsed,
+			                   static_cast<double>(found) / static_cast<double>(queries * k)});
+		}
+		return results;
+	}
+} // namespace
+
+auto main(int argc, char** argv) -> int {
+	auto const max_dimension = argc > 1 ? std::atoi(argv[1]) : 10'000'000;
+	auto counter = counting_resource(std::pmr::new_delete_resource());
+	std::pmr::set_default_resource(&counter);
+
+	auto results = std::vector<result>();
+	for (auto dimension = 1; dimension <= max_dimension; dimension *= 10) {
+		run_operations(counter, dimension, results);
+		if (dimension > max_dimension / 10) {
+			break;
+		}
+	}
+	auto const knn = run_knn();
+
+	std::printf("{\n  \"benchmarks\": [\n");
+	for (auto i = std::size_t{0}; i < results.size(); ++i) {
+		auto const& r = results[i];
+		std::printf("    {\"name\": \"%s\", \"dimension\": %d, \"iterations\": %zu, "
+		            "\"ns_per_op\": %.3f, \"gb_per_s\": %.3f, \"allocations_per_op\": %.3f}%s\n",
+		            r.name.c_str(),
+		            r.dimension,
+		            r.iterations,
+		            r.ns_per_op,
+		            r.gb_per_s,
+		            r.allocations_per_op,
+		            i + 1 == results.size() ? "" : ",");
+	}
+	std::printf("  ],\n  \"knn\": [\n");
+	for (auto i = std::size_t{0}; i < knn.size(); ++i) {
+		auto const& r = knn[i];
+		std::printf("    {\"mode\": \"%s\", \"probes\": %zu, \"qps\": %.1f, \"recall\": %.4f}%s\n",
+		            r.mode.c_str(),
+		            r.probes,
+		            r.qps,
+		            r.recall,
+		            i + 1 == knn.size() ? "" : ",");
+	}
+	std::printf("  ]\n}\n");
+	std::pmr::set_default_resource(nullptr);
+	return 0;
+}
@@ -0,0 +1,1043 @@
+#include "comp6771/euclidean_vector.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <memory_resource>
+#include <new>
+#include <span>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// a moved from vector has dimension 0 and no buffer,
+// anything that refills it must allocate a new one
+TEST_CASE("moved from vectors can be reused") {
+	auto const source = comp6771::euclidean_vector{1.0, 2.0, 3.0};
+
+	SECTION("after move construction") {
+		auto a = comp6771::euclidean_vector{4.0, 5.0, 6.0};
+		auto const b = std::move(a);
+		CHECK(a.dimensions() == 0);
+		a = source;
+		CHECK(a == source);
+		CHECK(b == comp6771::euclidean_vector{4.0, 5.0, 6.0});
+	}
+
+	SECTION("after move assignment") {
+		auto a = comp6771::euclidean_vector{4.0, 5.0, 6.0};
+		auto b = comp6771::euclidean_vector(2);
+		b = std::move(a);
+		CHECK(a.dimensions() == 0);
+		a = source;
+		CHECK(a == source);
+	}
+
+	SECTION("assign") {
+		auto a = comp6771::euclidean_vector{4.0, 5.0};
+		auto const b = std::move(a);
+		auto const values = std::vector<double>{7.0, 8.0, 9.0};
+		a.assign(values);
+		CHECK(a == comp6771::euclidean_vector{7.0, 8.0, 9.0});
+		CHECK(comp6771::euclidean_norm(a) == Approx(std::sqrt(49.0 + 64.0 + 81.0)));
+	}
+
+	SECTION("from_string") {
+		auto a = comp6771::euclidean_vector{4.0, 5.0};
+		auto const b = std::move(a);
+		comp6771::from_string("[1 2 3]", a);
+		CHECK(a == source);
+	}
+
+	SECTION("binary_reader") {
+		auto stream = std::stringstream();
+		comp6771::binary_writer(stream).write(source);
+		auto a = comp6771::euclidean_vector{4.0, 5.0};
+		auto const b = std::move(a);
+		CHECK(comp6771::binary_reader(stream).read(a));
+		CHECK(a == source);
+	}
+}
+
+TEST_CASE("storage comes from the given memory_resource") {
+	auto buffer = std::array<std::byte, 4096>();
+	auto arena = std::pmr::monotonic_buffer_resource(buffer.data(),
+	                                                 buffer.size(),
+	                                                 std::pmr::null_memory_resource());
+
+	SECTION("buffers are aligned to a cache line") {
+		auto const a = comp6771::euclidean_vector(3, 1.0, &arena);
+		auto const b = comp6771::euclidean_vector{1.0, 2.0, 3.0};
+		auto const c = comp6771::euclidean_vector(b, &arena);
+		for (auto const* v : {&a, &b, &c}) {
+			CHECK(reinterpret_cast<std::uintptr_t>(v->data()) % comp6771::euclidean_vector::alignment
+			      == 0);
+		}
+	}
+
+	SECTION("get_allocator returns the resource") {
+		auto const a = comp6771::euclidean_vector(3, &arena);
+		CHECK(a.get_allocator().resource() == &arena);
+		CHECK(comp6771::euclidean_vector(a).get_allocator().resource()
+		      == std::pmr::get_default_resource());
+		CHECK(comp6771::euclidean_vector(a, &arena).get_allocator().resource() == &arena);
+		auto b = comp6771::euclidean_vector({1.0, 2.0}, &arena);
+		auto const c = std::move(b);
+		CHECK(c.get_allocator().resource() == &arena);
+	}
+
+	SECTION("an exhausted resource throws std::bad_alloc") {
+		auto small = std::array<std::byte, 256>();
+		auto bounded = std::pmr::monotonic_buffer_resource(small.data(),
+		                                                   small.size(),
+		                                                   std::pmr::null_memory_resource());
+		CHECK_THROWS_AS(comp6771::euclidean_vector(1000, 0.0, &bounded), std::bad_alloc);
+		auto const values = std::vector<double>(1000, 1.0);
+		CHECK_THROWS_AS(comp6771::euclidean_vector(values.begin(), values.end(), &bounded),
+		                std::bad_alloc);
+		auto const big = comp6771::euclidean_vector(1000, 1.0);
+		CHECK_THROWS_AS(comp6771::euclidean_vector(big, &bounded), std::bad_alloc);
+
+		// a failed copy assignment leaves the target unchanged
+		auto v = comp6771::euclidean_vector(2, 3.0, &bounded);
+		CHECK_THROWS_AS(v = big, std::bad_alloc);
+		CHECK(v == comp6771::euclidean_vector(2, 3.0));
+	}
+}
+
+TEST_CASE("assign reuses the buffer or allocates a new one") {
+	auto const values = std::vector<double>{7.0, 8.0, 9.0};
+
+	SECTION("smaller vector grows") {
+		auto a = comp6771::euclidean_vector{1.0};
+		a.assign(values);
+		CHECK(a == comp6771::euclidean_vector{7.0, 8.0, 9.0});
+	}
+
+	SECTION("larger vector shrinks") {
+		auto a = comp6771::euclidean_vector(5, 1.0);
+		a.assign(values);
+		CHECK(a.dimensions() == 3);
+		CHECK(a == comp6771::euclidean_vector{7.0, 8.0, 9.0});
+	}
+
+	SECTION("moved from vector, then assigned again") {
+		auto a = comp6771::euclidean_vector(5, 1.0);
+		auto const b = std::move(a);
+		a.assign(std::vector<double>{});
+		CHECK(a.dimensions() == 0);
+		a.assign(values);
+		CHECK(a == comp6771::euclidean_vector{7.0, 8.0, 9.0});
+		CHECK(b == comp6771::euclidean_vector(5, 1.0));
+	}
+}
+
+TEST_CASE("fixed_point_vector arithmetic stays in range") {
+	auto const big = std::ldexp(1.0, comp6771::fixed_point_vector::integer_bits - 1);
+	auto const v = comp6771::euclidean_vector{1.5, big, -2.25};
+
+	SECTION("components at the limit are rejected") {
+		auto const limit = std::ldexp(1.0, comp6771::fixed_point_vector::integer_bits);
+		CHECK_THROWS_AS(comp6771::fixed_point_vector(comp6771::euclidean_vector{limit}),
+		                comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(comp6771::fixed_point_vector(comp6771::euclidean_vector{-limit}),
+		                comp6771::euclidean_vector_error);
+	}
+
+	SECTION("an overflowing sum throws and leaves the vector unchanged") {
+		auto a = comp6771::fixed_point_vector(v);
+		auto const b = comp6771::fixed_point_vector(v);
+		CHECK_THROWS_AS(a += b, comp6771::euclidean_vector_error);
+		CHECK(a[0] == 1.5);
+		CHECK(a[1] == big);
+		CHECK(a[2] == -2.25);
+	}
+
+	SECTION("an overflowing difference throws and leaves the vector unchanged") {
+		auto a = comp6771::fixed_point_vector(-v);
+		auto const b = comp6771::fixed_point_vector(v);
+		CHECK_THROWS_AS(a -= b, comp6771::euclidean_vector_error);
+		CHECK(a[0] == -1.5);
+		CHECK(a[1] == -big);
+	}
+
+	SECTION("sums in range are exact") {
+		auto a = comp6771::fixed_point_vector(comp6771::euclidean_vector{0.1, 0.2, 0.3});
+		auto const b = comp6771::fixed_point_vector(comp6771::euclidean_vector{0.3, 0.2, 0.1});
+		a += b;
+		a -= b;
+		CHECK(static_cast<comp6771::euclidean_vector>(a)
+		      == static_cast<comp6771::euclidean_vector>(
+		         comp6771::fixed_point_vector(comp6771::euclidean_vector{0.1, 0.2, 0.3})));
+	}
+}
+
+TEST_CASE("batched dot matches a serial dot for every pair") {
+	// 6 x 7 leaves a partial tile of xs and a partial block of ys
+	auto const length = 37;
+	auto xs = std::vector<comp6771::euclidean_vector>();
+	auto ys = std::vector<comp6771::euclidean_vector>();
+	for (auto i = 0; i < 6; ++i) {
+		auto& x = xs.emplace_back(length);
+		for (auto k = 0; k < length; ++k) {
+			x[k] = std::sin(i * length + k);
+		}
+	}
+	for (auto j = 0; j < 7; ++j) {
+		auto& y = ys.emplace_back(length);
+		for (auto k = 0; k < length; ++k) {
+			y[k] = std::cos(j * length + k);
+		}
+	}
+
+	auto const result = comp6771::dot(xs, ys);
+	REQUIRE(result.size() == xs.size() * ys.size());
+	for (auto i = std::size_t{0}; i < xs.size(); ++i) {
+		for (auto j = std::size_t{0}; j < ys.size(); ++j) {
+			auto serial = 0.0;
+			for (auto k = 0; k < length; ++k) {
+				serial += xs[i][k] * ys[j][k];
+			}
+			CHECK(result[i * ys.size() + j] == serial);
+		}
+	}
+}
+
+TEST_CASE("cow_euclidean_vector clones before writing") {
+	auto const values = comp6771::euclidean_vector{1.0, 2.0, 3.0};
+
+	SECTION("copies share the buffer until one is mutated") {
+		auto a = comp6771::cow_euclidean_vector(values);
+		auto b = a;
+		CHECK(a.shared());
+		CHECK(&a.get() == &b.get());
+		b *= 2.0;
+		CHECK(!a.shared());
+		CHECK(a.get() == values);
+		CHECK(b.get() == comp6771::euclidean_vector{2.0, 4.0, 6.0});
+	}
+
+	SECTION("a reference from operator[] is not seen by later copies") {
+		auto a = comp6771::cow_euclidean_vector(values);
+		auto& first = a[0];
+		auto const b = a;
+		CHECK(!a.shared());
+		first = 10.0;
+		CHECK(a[0] == 10.0);
+		CHECK(b[0] == 1.0);
+	}
+
+	SECTION("a reference from at is not seen by later copies") {
+		auto a = comp6771::cow_euclidean_vector(values);
+		auto& last = a.at(2);
+		auto b = comp6771::cow_euclidean_vector(1);
+		b = a;
+		last = 30.0;
+		CHECK(a.at(2) == 30.0);
+		CHECK(std::as_const(b).at(2) == 3.0);
+	}
+
+	SECTION("a moved from vector has dimension 0 and can be reused") {
+		auto a = comp6771::cow_euclidean_vector(values);
+		a[0] = 5.0;
+		auto b = std::move(a);
+		CHECK(b[0] == 5.0);
+		CHECK(a.dimensions() == 0);
+		CHECK(a.get() == comp6771::euclidean_vector(0));
+		CHECK(a == comp6771::cow_euclidean_vector(0));
+		CHECK(a != b);
+
+		auto c = comp6771::cow_euclidean_vector(values);
+		c = std::move(b);
+		CHECK(c[0] == 5.0);
+		CHECK(b.dimensions() == 0);
+		b *= 2.0;
+		CHECK(b.dimensions() == 0);
+		CHECK(a.dimensions() == 0);
+
+		a = c;
+		CHECK(a[0] == 5.0);
+		CHECK(c == comp6771::cow_euclidean_vector(comp6771::euclidean_vector{5.0, 2.0, 3.0}));
+	}
+}
+
+TEST_CASE("writing through a view drops the owner's cached norm") {
+	auto v = comp6771::euclidean_vector{3.0, 4.0};
+	auto view = comp6771::euclidean_vector_view(v);
+	CHECK(comp6771::euclidean_norm(v) == 5.0);
+
+	SECTION("operator[]") {
+		view[0] = 0.0;
+		CHECK(comp6771::euclidean_norm(v) == 4.0);
+		view[1] = 2.0;
+		CHECK(comp6771::euclidean_norm(v) == 2.0);
+	}
+
+	SECTION("at") {
+		view.at(1) = 0.0;
+		CHECK(comp6771::euclidean_norm(v) == 3.0);
+	}
+
+	SECTION("compound operators") {
+		view *= 2.0;
+		CHECK(comp6771::euclidean_norm(v) == 10.0);
+		view /= 10.0;
+		CHECK(comp6771::euclidean_norm(v) == 1.0);
+		view += comp6771::euclidean_vector{-0.6, 0.2};
+		CHECK(comp6771::euclidean_norm(v) == Approx(1.0));
+		view -= comp6771::euclidean_vector{0.0, 1.0};
+		CHECK(comp6771::euclidean_norm(v) == 0.0);
+	}
+}
+
+TEST_CASE("knn_index IVF build") {
+	auto vectors = std::vector<comp6771::euclidean_vector>();
+	for (auto i = 0; i < 200; ++i) {
+		vectors.push_back(comp6771::euclidean_vector{std::sin(i), std::cos(3 * i), (i % 5) * 1.0});
+	}
+	auto index = comp6771::knn_index(vectors);
+
+	SECTION("invalid arguments are rejected") {
+		CHECK_THROWS_AS(index.build_ivf(0), comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(index.build_ivf(201), comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(index.build_ivf(4, -1), comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(index.search_approximate(vectors[0], 3, 1), comp6771::euclidean_vector_error);
+	}
+
+	SECTION("probing every list is an exact search") {
+		index.build_ivf(8);
+		auto const exact = index.search(vectors[17], 5);
+		auto const approximate = index.search_approximate(vectors[17], 5, 8);
+		REQUIRE(approximate.size() == exact.size());
+		for (auto i = std::size_t{0}; i < exact.size(); ++i) {
+			CHECK(approximate[i].index == exact[i].index);
+			CHECK(approximate[i].distance == exact[i].distance);
+		}
+		CHECK(exact.front().index == 17);
+	}
+
+	SECTION("every row is in the list of its nearest centroid") {
+		index.build_ivf(4, 10);
+		for (auto i = std::size_t{0}; i < vectors.size(); i += 13) {
+			auto const nearest = index.search_approximate(vectors[i], 1, 1);
+			REQUIRE(nearest.size() == 1);
+			CHECK(nearest.front().distance == 0.0);
+		}
+	}
+}
+
+TEST_CASE("int8 quantisation needs finite components") {
+	using comp6771::precision;
+	auto const nan = std::numeric_limits<double>::quiet_NaN();
+	auto const inf = std::numeric_limits<double>::infinity();
+	CHECK_THROWS_AS(comp6771::quantised_vector(comp6771::euclidean_vector{1.0, nan}, precision::int8),
+	                comp6771::euclidean_vector_error);
+	CHECK_THROWS_AS(comp6771::quantised_vector(comp6771::euclidean_vector{inf, 1.0}, precision::int8),
+	                comp6771::euclidean_vector_error);
+	CHECK_THROWS_AS(comp6771::quantised_vector(comp6771::euclidean_vector{1.0, -inf}, precision::int8),
+	                comp6771::euclidean_vector_error);
+
+	auto const zero = comp6771::quantised_vector(comp6771::euclidean_vector{0.0, 0.0}, precision::int8);
+	CHECK(zero[0] == 0.0);
+
+	auto const tiny = std::numeric_limits<double>::denorm_min();
+	auto const q = comp6771::quantised_vector(comp6771::euclidean_vector{tiny, -tiny}, precision::int8);
+	CHECK(q[0] == tiny);
+	CHECK(q[1] == -tiny);
+
+	auto const v = comp6771::quantised_vector(comp6771::euclidean_vector{127.0, -63.5}, precision::int8);
+	CHECK(v[0] == 127.0);
+	CHECK(v[1] == -64.0);
+}
+
+TEST_CASE("operator<< pads the whole vector to the field width") {
+	auto const v = comp6771::euclidean_vector{1.0, 2.5};
+	auto os = std::ostringstream();
+	os << v;
+	CHECK(os.str() == "[1 2.5]");
+
+	os.str("");
+	os << std::setw(10) << v << '|';
+	CHECK(os.str() == "   [1 2.5]|");
+
+	os.str("");
+	os << std::left << std::setfill('*') << std::setw(9) << comp6771::const_euclidean_vector_view(v)
+	   << '|';
+	CHECK(os.str() == "[1 2.5]**|");
+
+	// shorter widths are ignored, and the width is reset afterwards
+	os.str("");
+	os << std::setw(3) << v << v;
+	CHECK(os.str() == "[1 2.5][1 2.5]");
+}
+
+TEST_CASE("set keeps the cached norm up to date") {
+	SECTION("small updates are applied to the cached sum") {
+		auto v = comp6771::euclidean_vector{3.0, 4.0};
+		CHECK(comp6771::euclidean_norm(v) == 5.0);
+		v.set(1, 0.0);
+		CHECK(comp6771::euclidean_norm(v) == 3.0);
+		v.set(0, 6.0);
+		CHECK(comp6771::euclidean_norm(v) == 6.0);
+		CHECK_THROWS_AS(v.set(2, 1.0), comp6771::euclidean_vector_error);
+	}
+
+	SECTION("cancellation recomputes the sum") {
+		auto v = comp6771::euclidean_vector{1e8, 1.0};
+		CHECK(comp6771::squared_euclidean_norm(v) == 1e16);
+		v.set(0, 0.0);
+		CHECK(comp6771::euclidean_norm(v) == 1.0);
+	}
+
+	SECTION("an overflowed sum is not cached") {
+		auto v = comp6771::euclidean_vector{1e200, 1.0};
+		CHECK(comp6771::squared_euclidean_norm(v) == std::numeric_limits<double>::infinity());
+		v.set(0, 0.0);
+		CHECK(comp6771::euclidean_norm(v) == 1.0);
+		v.set(1, 1e300);
+		CHECK(comp6771::euclidean_norm(v) == std::numeric_limits<double>::infinity());
+		v.set(1, 2.0);
+		CHECK(comp6771::euclidean_norm(v) == 2.0);
+	}
+
+	SECTION("the sum is recomputed exactly every exact_norm_interval updates") {
+		auto const length = 10;
+		auto v = comp6771::euclidean_vector(length, 1.0);
+		auto values = std::vector<double>(length, 1.0);
+		CHECK(comp6771::squared_euclidean_norm(v) == 10.0);
+		for (auto i = 0; i < comp6771::euclidean_vector::exact_norm_interval; ++i) {
+			auto const value = std::sin(i) * 1e3;
+			v.set(i % length, value);
+			values[static_cast<std::size_t>(i % length)] = value;
+			auto const exact = comp6771::euclidean_vector(values.begin(), values.end());
+			CHECK(comp6771::squared_euclidean_norm(v)
+			      == Approx(comp6771::squared_euclidean_norm(exact)).epsilon(1e-12));
+		}
+		auto const exact = comp6771::euclidean_vector(values.begin(), values.end());
+		CHECK(comp6771::squared_euclidean_norm(v) == comp6771::squared_euclidean_norm(exact));
+	}
+}
+
+namespace {
+	// the binary format of one vector, a little-endian uint64 dimension followed by
+	// the components, written by hand so corrupt input can be built
+	auto binary_input(std::uint64_t header, std::vector<double> const& values) -> std::string {
+		auto bytes = std::string(sizeof(header) + values.size() * sizeof(double), '\0');
+		std::memcpy(bytes.data(), &header, sizeof(header));
+		std::memcpy(bytes.data() + sizeof(header), values.data(), values.size() * sizeof(double));
+		return bytes;
+	}
+
+	// a stream buffer that cannot seek, like a pipe
+	class unseekable_buffer : public std::stringbuf {
+	public:
+		explicit unseekable_buffer(std::string const& bytes)
+		: std::stringbuf(bytes, std::ios::in) {}
+
+	protected:
+		auto seekoff(off_type, std::ios::seekdir, std::ios::openmode) -> pos_type override {
+			return pos_type(off_type(-1));
+		}
+
+		auto seekpos(pos_type, std::ios::openmode) -> pos_type override {
+			return pos_type(off_type(-1));
+		}
+	};
+} // namespace
+
+TEST_CASE("binary reader and writer") {
+	auto const a = comp6771::euclidean_vector{1.5, -2.0, 1e300};
+	auto const b = comp6771::euclidean_vector(0);
+	auto const c = comp6771::euclidean_vector(5, -0.0);
+
+	SECTION("vectors round trip through a stream and a buffer") {
+		auto stream = std::stringstream();
+		auto writer = comp6771::binary_writer(stream);
+		writer.write(a);
+		writer.write(b);
+		writer.write(c);
+		auto const bytes = stream.str();
+
+		auto reader = comp6771::binary_reader(stream);
+		auto v = comp6771::euclidean_vector(2);
+		CHECK(reader.read(v));
+		CHECK(v == a);
+		CHECK(reader.read(v));
+		CHECK(v == b);
+		CHECK(reader.read(v));
+		CHECK(v == c);
+		CHECK(!reader.read(v));
+		CHECK(!reader.read().has_value());
+
+		auto words = std::vector<std::uint64_t>(bytes.size() / sizeof(std::uint64_t));
+		std::memcpy(words.data(), bytes.data(), bytes.size());
+		auto buffer_reader = comp6771::binary_buffer_reader(std::as_bytes(std::span(words)));
+		CHECK(comp6771::euclidean_vector(*buffer_reader.next()) == a);
+		CHECK(buffer_reader.next()->dimensions() == 0);
+		CHECK(comp6771::euclidean_vector(*buffer_reader.next()) == c);
+		CHECK(!buffer_reader.next().has_value());
+	}
+
+	SECTION("a truncated payload is rejected") {
+		auto bytes = binary_input(3, {1.0, 2.0, 3.0});
+		bytes.pop_back();
+
+		auto stream = std::istringstream(bytes);
+		auto v = comp6771::euclidean_vector{7.0, 8.0, 9.0, 10.0};
+		CHECK_THROWS_AS(comp6771::binary_reader(stream).read(v), comp6771::euclidean_vector_error);
+		CHECK(v == comp6771::euclidean_vector{7.0, 8.0, 9.0, 10.0});
+
+		// without seeking the shortfall is only found after reading
+		auto unseekable = unseekable_buffer(bytes);
+		auto pipe = std::istream(&unseekable);
+		CHECK_THROWS_AS(comp6771::binary_reader(pipe).read(v), comp6771::euclidean_vector_error);
+		CHECK(v.dimensions() == 0);
+
+		auto words = std::vector<std::uint64_t>(4);
+		std::memcpy(words.data(), bytes.data(), bytes.size());
+		auto buffer_reader =
+		   comp6771::binary_buffer_reader(std::as_bytes(std::span(words)).first(bytes.size()));
+		CHECK_THROWS_AS(buffer_reader.next(), comp6771::euclidean_vector_error);
+
+		auto header_only = std::istringstream(std::string(5, '\0'));
+		CHECK_THROWS_AS(comp6771::binary_reader(header_only).read(v),
+		                comp6771::euclidean_vector_error);
+	}
+
+	SECTION("a corrupt dimension is rejected before allocating") {
+		auto v = comp6771::euclidean_vector{7.0};
+		for (auto const header : {std::uint64_t{1} << 40,
+		                          std::uint64_t{std::numeric_limits<int>::max()} + 1}) {
+			auto bytes = binary_input(header, {1.0});
+			bytes.resize(9);
+			auto stream = std::istringstream(bytes);
+			CHECK_THROWS_AS(comp6771::binary_reader(stream).read(v), comp6771::euclidean_vector_error);
+			auto unseekable = unseekable_buffer(bytes);
+			auto pipe = std::istream(&unseekable);
+			CHECK_THROWS_AS(comp6771::binary_reader(pipe).read(v), comp6771::euclidean_vector_error);
+			CHECK(v == comp6771::euclidean_vector{7.0});
+
+			auto words = std::vector<std::uint64_t>{header, 0};
+			auto buffer_reader = comp6771::binary_buffer_reader(std::as_bytes(std::span(words)));
+			CHECK_THROWS_AS(buffer_reader.next(), comp6771::euclidean_vector_error);
+		}
+
+		// a dimension that fits an int but not the input fails without allocating
+		auto stream = std::istringstream(binary_input(std::numeric_limits<int>::max(), {1.0}));
+		CHECK_THROWS_AS(comp6771::binary_reader(stream).read(v), comp6771::euclidean_vector_error);
+		CHECK(v == comp6771::euclidean_vector{7.0});
+	}
+}
+
+TEST_CASE("sparse_euclidean_vector") {
+	using comp6771::sparse_euclidean_vector;
+	// 16 components densify once more than 4 are non-zero
+	auto const dimension = 16;
+	auto const x = sparse_euclidean_vector(dimension, {{3, 2.0}, {0, 1.0}, {9, -1.5}, {3, 1.0}});
+	auto const y = sparse_euclidean_vector(dimension, {{9, 4.0}, {15, 2.0}, {3, 0.5}});
+
+	SECTION("entries are sorted and repeated indices summed") {
+		CHECK(x.non_zeros() == 3);
+		CHECK(x[0] == 1.0);
+		CHECK(x[3] == 3.0);
+		CHECK(x[4] == 0.0);
+		CHECK(static_cast<comp6771::euclidean_vector>(x)[9] == -1.5);
+		CHECK(sparse_euclidean_vector(dimension, {{2, 1.0}, {2, -1.0}, {5, 0.0}}).non_zeros() == 0);
+		CHECK_THROWS_AS(sparse_euclidean_vector(dimension, {{dimension, 1.0}}),
+		                comp6771::euclidean_vector_error);
+	}
+
+	SECTION("dot products match the dense dot") {
+		auto const dense_x = static_cast<comp6771::euclidean_vector>(x);
+		auto const dense_y = static_cast<comp6771::euclidean_vector>(y);
+		auto const expected = comp6771::dot(dense_x, dense_y);
+		CHECK(expected == 3.0 * 0.5 - 1.5 * 4.0);
+		CHECK(comp6771::dot(x, y) == expected);
+		CHECK(comp6771::dot(x, dense_y) == expected);
+		CHECK(comp6771::dot(dense_x, y) == expected);
+		CHECK_THROWS_AS(comp6771::dot(x, sparse_euclidean_vector(3)), comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(comp6771::dot(x, comp6771::euclidean_vector(3)),
+		                comp6771::euclidean_vector_error);
+	}
+
+	SECTION("arithmetic matches the dense arithmetic") {
+		auto const dense_x = static_cast<comp6771::euclidean_vector>(x);
+		auto const dense_y = static_cast<comp6771::euclidean_vector>(y);
+		CHECK(static_cast<comp6771::euclidean_vector>(x + y) == dense_x + dense_y);
+		CHECK(static_cast<comp6771::euclidean_vector>(x - y) == dense_x - dense_y);
+		CHECK(static_cast<comp6771::euclidean_vector>(x * 2.0) == dense_x * 2.0);
+		CHECK(static_cast<comp6771::euclidean_vector>(0.5 * y) == 0.5 * dense_y);
+		CHECK(static_cast<comp6771::euclidean_vector>(y / 4.0) == dense_y / 4.0);
+		CHECK_THROWS_AS(x / 0.0, comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(x + sparse_euclidean_vector(3), comp6771::euclidean_vector_error);
+		CHECK(comp6771::euclidean_norm(x) == Approx(comp6771::euclidean_norm(dense_x)));
+	}
+
+	SECTION("components that become zero are not stored") {
+		auto v = x;
+		v.set(5, 0.0);
+		CHECK(v.non_zeros() == 3);
+		v.set(0, 0.0);
+		CHECK(v.non_zeros() == 2);
+		CHECK(v[0] == 0.0);
+
+		auto w = x;
+		w -= x;
+		CHECK(w.non_zeros() == 0);
+		CHECK(w == sparse_euclidean_vector(dimension));
+
+		w = x * 0.0;
+		CHECK(w.non_zeros() == 0);
+
+		// cancelling at index 9 leaves 0, 3 and 15
+		CHECK((x + sparse_euclidean_vector(dimension, {{9, 1.5}, {15, 1.0}})).non_zeros() == 3);
+	}
+
+	SECTION("more than densify_threshold non-zeros switch to dense storage") {
+		auto v = sparse_euclidean_vector(dimension);
+		for (auto i = 0; i < dimension; ++i) {
+			v.set(i, 0.0);
+		}
+		CHECK(not v.is_dense());
+		for (auto i = 0; i < 4; ++i) {
+			v.set(i, 1.0);
+		}
+		CHECK(not v.is_dense());
+		v.set(10, 1.0);
+		CHECK(v.is_dense());
+		CHECK(v.non_zeros() == dimension);
+		CHECK(v[10] == 1.0);
+		v.set(10, 0.0);
+		CHECK(v.is_dense());
+		CHECK(v[10] == 0.0);
+
+		auto const dense = x + sparse_euclidean_vector(dimension, {{1, 1.0}, {2, 1.0}});
+		CHECK(dense.is_dense());
+		CHECK(comp6771::dot(dense, y) == comp6771::dot(x, y));
+	}
+
+	SECTION("equality ignores the storage") {
+		auto const dense_x = static_cast<comp6771::euclidean_vector>(x);
+		CHECK(sparse_euclidean_vector(dense_x) == x);
+		auto dense = x + sparse_euclidean_vector(dimension, {{1, 1.0}, {2, 1.0}});
+		CHECK(dense.is_dense());
+		CHECK(dense != x);
+		dense.set(1, 0.0);
+		dense.set(2, 0.0);
+		CHECK(dense == x);
+		CHECK(x == dense);
+		CHECK(x != y);
+		CHECK(x != sparse_euclidean_vector(dimension + 1));
+	}
+}
+
+namespace {
+	// small integers, so every sum is exact whatever order it is added in
+	auto integer_matrix(int rows, int columns) -> comp6771::euclidean_matrix {
+		auto m = comp6771::euclidean_matrix(rows, columns);
+		for (auto r = 0; r < rows; ++r) {
+			for (auto c = 0; c < columns; ++c) {
+				m(r, c) = static_cast<double>((r * 7 + c * 3) % 9 - 4);
+			}
+		}
+		return m;
+	}
+
+	auto integer_vector(int dimension, int seed) -> comp6771::euclidean_vector {
+		auto v = comp6771::euclidean_vector(dimension);
+		for (auto i = 0; i < dimension; ++i) {
+			v[i] = static_cast<double>((i * 5 + seed) % 7 - 3);
+		}
+		return v;
+	}
+
+	auto naive_product(comp6771::euclidean_matrix const& m, comp6771::euclidean_vector const& v)
+	   -> comp6771::euclidean_vector {
+		auto result = comp6771::euclidean_vector(m.rows());
+		for (auto r = 0; r < m.rows(); ++r) {
+			for (auto c = 0; c < m.columns(); ++c) {
+				result[r] += m(r, c) * v[c];
+			}
+		}
+		return result;
+	}
+
+	auto naive_transposed_product(comp6771::euclidean_matrix const& m,
+	                              comp6771::euclidean_vector const& v) -> comp6771::euclidean_vector {
+		auto result = comp6771::euclidean_vector(m.columns());
+		for (auto r = 0; r < m.rows(); ++r) {
+			for (auto c = 0; c < m.columns(); ++c) {
+				result[c] += m(r, c) * v[r];
+			}
+		}
+		return result;
+	}
+
+	auto check_products(int rows, int columns, int vectors) -> void {
+		auto const m = integer_matrix(rows, columns);
+		auto const v = integer_vector(columns, 1);
+		CHECK(m * v == naive_product(m, v));
+		auto const u = integer_vector(rows, 2);
+		CHECK(comp6771::transposed_product(m, u) == naive_transposed_product(m, u));
+
+		auto batch = std::vector<comp6771::euclidean_vector>();
+		for (auto j = 0; j < vectors; ++j) {
+			batch.push_back(integer_vector(columns, j));
+		}
+		auto const results = comp6771::transform_batch(m, batch);
+		REQUIRE(results.size() == batch.size());
+		for (auto j = std::size_t{0}; j < batch.size(); ++j) {
+			CHECK(results[j] == naive_product(m, batch[j]));
+		}
+	}
+} // namespace
+
+TEST_CASE("euclidean_matrix products match a naive loop") {
+	SECTION("rows and vectors that are not multiples of the 4 x 4 tile") {
+		check_products(7, 13, 6);
+		check_products(1, 1, 1);
+		check_products(4, 8, 4);
+		check_products(66, 35, 3);
+	}
+
+	// each product does more than 2^20 multiply-adds, so the bands run in parallel
+	SECTION("matrices above the parallel threshold") {
+		auto const m = integer_matrix(1031, 1027);
+		auto const v = integer_vector(1027, 1);
+		CHECK(m * v == naive_product(m, v));
+		auto const u = integer_vector(1031, 2);
+		CHECK(comp6771::transposed_product(m, u) == naive_transposed_product(m, u));
+		check_products(131, 129, 63);
+	}
+
+	SECTION("rows are views into the matrix") {
+		auto const rows = std::vector<comp6771::euclidean_vector>{{1.0, 2.0}, {3.0, 4.0}, {5.0, 6.0}};
+		auto m = comp6771::euclidean_matrix(rows);
+		CHECK(m.rows() == 3);
+		CHECK(m.columns() == 2);
+		CHECK(comp6771::euclidean_vector(m.row(1)) == rows[1]);
+		m.row(2)[0] = 7.0;
+		CHECK(m(2, 0) == 7.0);
+		CHECK(m == comp6771::euclidean_matrix(std::vector<comp6771::euclidean_vector>{
+		              {1.0, 2.0}, {3.0, 4.0}, {7.0, 6.0}}));
+	}
+
+	SECTION("mismatched dimensions are rejected") {
+		auto const m = integer_matrix(3, 2);
+		CHECK_THROWS_AS(m * comp6771::euclidean_vector(3), comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(comp6771::transposed_product(m, comp6771::euclidean_vector(2)),
+		                comp6771::euclidean_vector_error);
+		auto const batch = std::vector<comp6771::euclidean_vector>{comp6771::euclidean_vector(2),
+		                                                           comp6771::euclidean_vector(3)};
+		CHECK_THROWS_AS(comp6771::transform_batch(m, batch), comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(comp6771::euclidean_matrix(batch), comp6771::euclidean_vector_error);
+	}
+}
+
+TEST_CASE("hashing and approximate equality") {
+	SECTION("equal vectors hash alike, including 0.0 and -0.0") {
+		auto const a = comp6771::euclidean_vector{0.0, 1.5, -2.0, 0.0, 3.0};
+		auto const b = comp6771::euclidean_vector{-0.0, 1.5, -2.0, -0.0, 3.0};
+		REQUIRE(a == b);
+		CHECK(comp6771::hash_value(a) == comp6771::hash_value(b));
+		CHECK(comp6771::hash_value(comp6771::euclidean_vector(a)) == comp6771::hash_value(a));
+		CHECK(std::hash<comp6771::euclidean_vector>()(a) == comp6771::hash_value(a));
+		CHECK(comp6771::hash_value(a) != comp6771::hash_value(comp6771::euclidean_vector{0.0, 1.5}));
+		CHECK(comp6771::hash_value(a)
+		      != comp6771::hash_value(comp6771::euclidean_vector{0.0, 1.5, -2.0, 0.0, 3.5}));
+		// the hash includes the dimension, so trailing zeros change it
+		CHECK(comp6771::hash_value(comp6771::euclidean_vector(3))
+		      != comp6771::hash_value(comp6771::euclidean_vector(4)));
+	}
+
+	SECTION("approx_equal has isclose semantics") {
+		auto const x = comp6771::euclidean_vector{1.0, 1e6, 0.0};
+		CHECK(comp6771::approx_equal(x, x));
+		CHECK(comp6771::approx_equal(x, comp6771::euclidean_vector{1.0 + 1e-10, 1e6 + 1e-4, 0.0}));
+		CHECK(!comp6771::approx_equal(x, comp6771::euclidean_vector{1.0 + 1e-8, 1e6, 0.0}));
+		// the relative tolerance scales with the larger magnitude
+		CHECK(comp6771::approx_equal(comp6771::euclidean_vector{100.0},
+		                             comp6771::euclidean_vector{101.0},
+		                             0.01));
+		CHECK(!comp6771::approx_equal(comp6771::euclidean_vector{100.0},
+		                              comp6771::euclidean_vector{102.0},
+		                              0.01));
+		// near zero only the absolute tolerance helps
+		auto const zero = comp6771::euclidean_vector{1.0, 0.0};
+		auto const tiny = comp6771::euclidean_vector{1.0, 1e-12};
+		CHECK(!comp6771::approx_equal(zero, tiny));
+		CHECK(comp6771::approx_equal(zero, tiny, 1e-9, 1e-11));
+		CHECK(!comp6771::approx_equal(zero, tiny, 1e-9, 1e-13));
+		CHECK(!comp6771::approx_equal(x, comp6771::euclidean_vector{1.0, 1e6}));
+
+		// an infinity is only close to itself, and NaN to nothing
+		auto const inf = comp6771::euclidean_vector{std::numeric_limits<double>::infinity()};
+		auto const nan = comp6771::euclidean_vector{std::numeric_limits<double>::quiet_NaN()};
+		CHECK(comp6771::approx_equal(inf, inf));
+		CHECK(!comp6771::approx_equal(inf, -inf));
+		CHECK(!comp6771::approx_equal(inf, comp6771::euclidean_vector{1.0}));
+		CHECK(!comp6771::approx_equal(comp6771::euclidean_vector{1e308}, inf, 0.5, inf[0]));
+		CHECK(!comp6771::approx_equal(nan, nan));
+	}
+
+	SECTION("hyperplane signatures are deterministic for a seed") {
+		auto const v = comp6771::euclidean_vector{0.3, -1.2, 2.5, 0.7, -0.1, 1.9};
+		auto const a = comp6771::hyperplane_hasher(6, 64, 42);
+		auto const b = comp6771::hyperplane_hasher(6, 64, 42);
+		CHECK(a(v) == b(v));
+		CHECK(a(v) != comp6771::hyperplane_hasher(6, 64, 43)(v));
+		// the opposite vector is on the other side of every plane
+		CHECK(a(-v) == ~a(v));
+		// scaling does not move a vector across a plane
+		CHECK(a(v * 3.0) == a(v));
+
+		auto const narrow = comp6771::hyperplane_hasher(6, 5, 42);
+		CHECK(narrow.bits() == 5);
+		CHECK(narrow.dimensions() == 6);
+		CHECK(narrow(v) < (std::uint64_t{1} << 5U));
+		CHECK_THROWS_AS(narrow(comp6771::euclidean_vector(5)), comp6771::euclidean_vector_error);
+	}
+
+	SECTION("bits outside 1 to 64 are rejected") {
+		CHECK_THROWS_AS(comp6771::hyperplane_hasher(6, 0), comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(comp6771::hyperplane_hasher(6, -1), comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(comp6771::hyperplane_hasher(6, 65), comp6771::euclidean_vector_error);
+		CHECK_NOTHROW(comp6771::hyperplane_hasher(6, 1));
+		CHECK_NOTHROW(comp6771::hyperplane_hasher(6, 64));
+	}
+}
+
+TEST_CASE("BLAS-1 style updates") {
+	auto const x = comp6771::euclidean_vector{1.0, -2.0, 4.0};
+
+	SECTION("axpy adds a multiple of x") {
+		auto y = comp6771::euclidean_vector{0.5, 0.5, 0.5};
+		CHECK(comp6771::euclidean_norm(y) == Approx(std::sqrt(0.75)));
+		CHECK(&y.axpy(2.0, x) == &y);
+		CHECK(y == comp6771::euclidean_vector{2.5, -3.5, 8.5});
+		CHECK(comp6771::euclidean_norm(y) == Approx(std::sqrt(2.5 * 2.5 + 3.5 * 3.5 + 8.5 * 8.5)));
+	}
+
+	SECTION("axpby scales both operands") {
+		auto y = comp6771::euclidean_vector{1.0, 1.0, 1.0};
+		y.axpby(0.5, x, -2.0);
+		CHECK(y == comp6771::euclidean_vector{-1.5, -3.0, 0.0});
+		y.axpby(1.0, x, 0.0);
+		CHECK(y == x);
+	}
+
+	SECTION("scale_add scales this and adds x") {
+		auto y = comp6771::euclidean_vector{1.0, 2.0, 3.0};
+		y.scale_add(3.0, x);
+		CHECK(y == comp6771::euclidean_vector{4.0, 4.0, 13.0});
+		// x can be a view, here of y itself
+		y.scale_add(1.0, comp6771::const_euclidean_vector_view(y));
+		CHECK(y == comp6771::euclidean_vector{8.0, 8.0, 26.0});
+	}
+
+	SECTION("mismatched dimensions are rejected and leave this unchanged") {
+		auto y = comp6771::euclidean_vector{1.0, 2.0};
+		CHECK_THROWS_AS(y.axpy(1.0, x), comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(y.axpby(1.0, x, 1.0), comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(y.scale_add(1.0, x), comp6771::euclidean_vector_error);
+		CHECK(y == comp6771::euclidean_vector{1.0, 2.0});
+	}
+
+	SECTION("linear_combination sums the scaled vectors") {
+		auto const vectors = std::vector<comp6771::euclidean_vector>{x,
+		                                                             {0.0, 1.0, 0.0},
+		                                                             {2.0, 2.0, 2.0}};
+		auto const coefficients = std::vector<double>{2.0, -1.0, 0.5};
+		CHECK(comp6771::linear_combination(coefficients, vectors)
+		      == comp6771::euclidean_vector{3.0, -4.0, 9.0});
+		auto const first = std::span(vectors).first(1);
+		CHECK(comp6771::linear_combination(std::vector<double>{1.0}, first) == x);
+
+		// long enough to span several blocks
+		auto const length = 100000;
+		auto const long_vectors =
+		   std::vector<comp6771::euclidean_vector>{comp6771::euclidean_vector(length, 1.0),
+		                                           comp6771::euclidean_vector(length, 2.0)};
+		CHECK(comp6771::linear_combination(std::vector<double>{3.0, 0.25}, long_vectors)
+		      == comp6771::euclidean_vector(length, 3.5));
+
+		CHECK_THROWS_AS(comp6771::linear_combination(std::vector<double>{1.0}, vectors),
+		                comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(comp6771::linear_combination({}, {}), comp6771::euclidean_vector_error);
+		auto const mixed = std::vector<comp6771::euclidean_vector>{x, {1.0}};
+		CHECK_THROWS_AS(comp6771::linear_combination(std::vector<double>{1.0, 1.0}, mixed),
+		                comp6771::euclidean_vector_error);
+	}
+}
+
+TEST_CASE("mismatched dimensions throw from every checked operation") {
+	auto const a = comp6771::euclidean_vector{1.0, 2.0, 3.0};
+	auto const b = comp6771::euclidean_vector{1.0, 2.0};
+	auto const message = "Dimensions of LHS(3) and RHS(2) do not match";
+	CHECK_THROWS_WITH(a - b, message);
+	CHECK_THROWS_WITH(a + b, message);
+	CHECK_THROWS_WITH(comp6771::dot(a, b), message);
+	auto c = a;
+	CHECK_THROWS_WITH(c -= b, message);
+	CHECK_THROWS_WITH(c += b, message);
+	CHECK(c == a);
+	CHECK(a - a == comp6771::euclidean_vector(3));
+
+	CHECK_THROWS_WITH(c.at(3), "Index 3 is not valid for this euclidean_vector object");
+	CHECK_THROWS_WITH(c / 0.0, "Invalid vector division by 0");
+
+	// the unchecked variants trust the caller
+	comp6771::unchecked::subtract(c, a);
+	CHECK(c == comp6771::euclidean_vector(3));
+	comp6771::unchecked::add(c, a);
+	CHECK(c == a);
+	CHECK(comp6771::unchecked::dot(a, a) == 14.0);
+}
+
+TEST_CASE("distances and k-means") {
+	SECTION("squared_distance matches the norm of the difference") {
+		auto const a = comp6771::euclidean_vector{1.0, 2.0, 3.0};
+		auto const b = comp6771::euclidean_vector{4.0, -2.0, 3.5};
+		CHECK(comp6771::squared_distance(a, b) == Approx(9.0 + 16.0 + 0.25));
+		CHECK(comp6771::squared_distance(a, b) == comp6771::squared_distance(b, a));
+		CHECK_THROWS_AS(comp6771::squared_distance(a, comp6771::euclidean_vector(2)),
+		                comp6771::euclidean_vector_error);
+
+		// |a|^2 + |b|^2 - 2a.b can round below 0 for nearly equal vectors
+		auto const c = comp6771::euclidean_vector{0.1, 0.7, 1e8 / 3.0};
+		auto d = c;
+		d[0] = std::nextafter(0.1, 1.0);
+		CHECK(comp6771::squared_distance(c, c) >= 0.0);
+		CHECK(comp6771::squared_distance(c, d) >= 0.0);
+	}
+
+	auto const points = std::vector<comp6771::euclidean_vector>{
+	   {0.0, 0.0},
+	   {1.0, 0.0},
+	   {0.0, 1.0},
+	   {10.0, 10.0},
+	   {11.0, 10.0},
+	   {10.0, 12.0},
+	};
+
+	SECTION("pairwise distances match squared_distance") {
+		auto const ys = std::span(points).first(4);
+		auto const squared = comp6771::pairwise_squared_distances(points, ys);
+		REQUIRE(squared.size() == points.size() * ys.size());
+		for (auto i = std::size_t{0}; i < points.size(); ++i) {
+			for (auto j = std::size_t{0}; j < ys.size(); ++j) {
+				auto const expected = comp6771::squared_distance(points[i], ys[j]);
+				CHECK(squared[i * ys.size() + j] == Approx(expected));
+			}
+		}
+
+		auto const n = points.size();
+		auto const distances = comp6771::pairwise_distances(points);
+		REQUIRE(distances.size() == n * n);
+		for (auto i = std::size_t{0}; i < n; ++i) {
+			CHECK(distances[i * n + i] == 0.0);
+			for (auto j = std::size_t{0}; j < n; ++j) {
+				CHECK(distances[i * n + j] == distances[j * n + i]);
+				CHECK(distances[i * n + j]
+				      == Approx(std::sqrt(comp6771::squared_distance(points[i], points[j]))));
+			}
+		}
+		CHECK(distances[0 * n + 4] == Approx(std::sqrt(221.0)));
+	}
+
+	SECTION("kmeans_step assigns points and moves centroids to the means") {
+		auto centroids =
+		   std::vector<comp6771::euclidean_vector>{{1.0, 1.0}, {9.0, 9.0}, {-50.0, 50.0}};
+		auto assignment = std::vector<std::size_t>(points.size(), 0);
+		CHECK(comp6771::kmeans_step(points, centroids, assignment) == 3);
+		CHECK(assignment == std::vector<std::size_t>{0, 0, 0, 1, 1, 1});
+		CHECK(comp6771::approx_equal(centroids[0], comp6771::euclidean_vector{1.0 / 3.0, 1.0 / 3.0}));
+		CHECK(comp6771::approx_equal(centroids[1],
+		                             comp6771::euclidean_vector{31.0 / 3.0, 32.0 / 3.0}));
+		// a centroid with no points stays where it was
+		CHECK(centroids[2] == comp6771::euclidean_vector{-50.0, 50.0});
+		CHECK(comp6771::euclidean_norm(centroids[0]) == Approx(std::sqrt(2.0) / 3.0));
+
+		CHECK(comp6771::kmeans_step(points, centroids, assignment) == 0);
+	}
+
+	SECTION("kmeans stops once nothing moves") {
+		auto centroids = std::vector<comp6771::euclidean_vector>{{0.0, 0.0}, {1.0, 0.0}};
+		auto assignment = std::vector<std::size_t>(points.size(), 0);
+		auto const iterations = comp6771::kmeans(points, centroids, assignment);
+		CHECK(iterations < 100);
+		CHECK(assignment == std::vector<std::size_t>{0, 0, 0, 1, 1, 1});
+		CHECK(comp6771::kmeans(points, centroids, assignment) == 1);
+
+		auto limited = std::vector<comp6771::euclidean_vector>{{0.0, 0.0}, {1.0, 0.0}};
+		CHECK(comp6771::kmeans(points, limited, assignment, 1) == 1);
+	}
+
+	SECTION("k-means rejects inconsistent arguments") {
+		auto centroids = std::vector<comp6771::euclidean_vector>{{0.0, 0.0}};
+		auto assignment = std::vector<std::size_t>(points.size());
+		auto short_assignment = std::vector<std::size_t>(2);
+		auto no_centroids = std::vector<comp6771::euclidean_vector>();
+		auto wide = std::vector<comp6771::euclidean_vector>{{0.0, 0.0, 0.0}};
+		CHECK_THROWS_AS(comp6771::kmeans_step(points, no_centroids, assignment),
+		                comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(comp6771::kmeans_step(points, centroids, short_assignment),
+		                comp6771::euclidean_vector_error);
+		CHECK_THROWS_AS(comp6771::kmeans_step(points, wide, assignment),
+		                comp6771::euclidean_vector_error);
+	}
+}
+
+TEST_CASE("compensated summation recovers what a naive sum loses") {
+	using comp6771::euclidean_vector;
+	auto const naive_dot = [](euclidean_vector const& x, euclidean_vector const& y) {
+		auto sum = 0.0;
+		for (auto i = 0; i < x.dimensions(); ++i) {
+			sum += x[i] * y[i];
+		}
+		return sum;
+	};
+
+	SECTION("small terms between cancelling large ones") {
+		// 1e16 + 1 rounds back to 1e16, so a left to right sum drops every 1
+		auto const length = 3000;
+		auto x = comp6771::euclidean_vector(length);
+		for (auto i = 0; i < length; i += 3) {
+			x[i] = 1e16;
+			x[i + 1] = 1.0;
+			x[i + 2] = -1e16;
+		}
+		auto const y = comp6771::euclidean_vector(length, 1.0);
+		CHECK(naive_dot(x, y) == 0.0);
+		CHECK(comp6771::dot(x, y, comp6771::summation::compensated) == 1000.0);
+	}
+
+	SECTION("the rounding error of a product") {
+		// a * a is 1 + 2^-29 + 2^-60, which rounds to p = 1 + 2^-29
+		auto const a = 1.0 + 0x1p-30;
+		auto const p = 1.0 + 0x1p-29;
+		auto const x = comp6771::euclidean_vector{a, -1.0};
+		auto const y = comp6771::euclidean_vector{a, p};
+		CHECK(naive_dot(x, y) == 0.0);
+		CHECK(comp6771::dot(x, y, comp6771::summation::compensated) == 0x1p-60);
+	}
+
+	SECTION("norms and the fast mode") {
+		auto const v = comp6771::euclidean_vector{3.0, 4.0, 12.0};
+		CHECK(comp6771::squared_euclidean_norm(v, comp6771::summation::compensated) == 169.0);
+		CHECK(comp6771::euclidean_norm(v, comp6771::summation::compensated) == 13.0);
+		CHECK(comp6771::dot(v, v, comp6771::summation::fast) == comp6771::dot(v, v));
+		CHECK(comp6771::euclidean_norm(v, comp6771::summation::fast) == 13.0);
+		CHECK_THROWS_AS(comp6771::dot(v,
+		                              comp6771::euclidean_vector(2),
+		                              comp6771::summation::compensated),
+		                comp6771::euclidean_vector_error);
+	}
+}
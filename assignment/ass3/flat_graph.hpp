@@ -0,0 +1,475 @@
+#ifndef GDWG_FLAT_GRAPH_HPP
+#define GDWG_FLAT_GRAPH_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace gdwg {
+	// gdwg::graph with the same interface, iteration order and exceptions,
+	// stored in two sorted contiguous arrays instead of node-based trees
+	// - nodes_ holds the node values in ascending order
+	// - edges_ holds {from, to, weight} sorted by (from, to, weight), where
+	//   from and to are positions in nodes_
+	// because nodes_ is sorted, ordering edges by node position is the same as
+	// ordering them by node value, so edges_ is already in iteration order
+	// lookups are binary searches over contiguous memory, while inserting or
+	// erasing shifts the arrays (and renumbers edges when a node moves), so this
+	// suits graphs that are built once and then read many times
+	// every member has graph's exception specification, so like graph's the
+	// noexcept members that allocate terminate if the allocation fails
+	template<typename N, typename E>
+	class flat_graph {
+	public:
+		struct value_type {
+			N from;
+			N to;
+			E weight;
+		};
+
+		flat_graph() = default;
+
+		flat_graph(std::initializer_list<N> il)
+		: flat_graph(il.begin(), il.end()) {}
+
+		// Complexity: O(n log(n))
+		template<typename InputIt>
+		flat_graph(InputIt first, InputIt last)
+		: nodes_(first, last) {
+			std::sort(nodes_.begin(), nodes_.end());
+			nodes_.erase(std::unique(nodes_.begin(),
+			                         nodes_.end(),
+			                         [](N const& a, N const& b) { return !(a < b) && !(b < a); }),
+			             nodes_.end());
+		}
+
+		flat_graph(flat_graph&& other) noexcept = default;
+
+		auto operator=(flat_graph&& other) noexcept -> flat_graph& = default;
+
+		flat_graph(flat_graph const& other) noexcept = default;
+
+		auto operator=(flat_graph const& other) noexcept -> flat_graph& = default;
+
+		// Complexity: O(n+e)
+		auto insert_node(N const& value) noexcept -> bool {
+			auto iter = std::lower_bound(nodes_.begin(), nodes_.end(), value);
+			if (iter != nodes_.end() && !(value < *iter)) {
+				return false;
+			}
+			auto const position = static_cast<std::size_t>(iter - nodes_.begin());
+			nodes_.insert(iter, value);
+			// every node after the new one moved up by one
+			for (auto& e : edges_) {
+				e.from += e.from >= position ? 1 : 0;
+				e.to += e.to >= position ? 1 : 0;
+			}
+			return true;
+		}
+
+		// Complexity: O(log(n)+e)
+		auto insert_edge(N const& src, N const& dst, E const& weight) -> bool {
+			auto const from = index_of(src);
+			auto const to = index_of(dst);
+			if (from == npos || to == npos) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::insert_edge when either src "
+				                         "or dst node does not exist");
+			}
+			auto const iter = edge_lower_bound(from, to, weight);
+			if (iter != edges_.end() && !edge_cmp{}(key{from, to, &weight}, *iter)) {
+				return false;
+			}
+			edges_.insert(iter, edge{from, to, weight});
+			return true;
+		}
+
+		auto replace_node(N const& old_data, N const& new_data) -> bool {
+			if (!is_node(old_data)) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::replace_node on a node that "
+				                         "doesn't exist");
+			}
+			if (is_node(new_data)) {
+				return false;
+			}
+			insert_node(new_data);
+			merge_replace_node(old_data, new_data);
+			return true;
+		}
+
+		// Complexity: O(n+e+r log(r)) - r is the number of edges touching old_data
+		auto merge_replace_node(N const& old_data, N const& new_data) -> void {
+			auto const old_index = index_of(old_data);
+			auto const new_index = index_of(new_data);
+			if (old_index == npos || new_index == npos) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::merge_replace_node on old or "
+				                         "new data if they don't exist in the graph");
+			}
+			if (old_index == new_index) {
+				return;
+			}
+			// move the edges touching the old node out and redirect them, the rest
+			// stay sorted, so only the redirected edges need sorting before the two
+			// runs are merged and the edges that became duplicates are dropped
+			auto redirected = std::vector<edge>();
+			auto kept = std::size_t{0};
+			for (auto i = std::size_t{0}; i < edges_.size(); ++i) {
+				auto& e = edges_[i];
+				if (e.from == old_index || e.to == old_index) {
+					redirected.push_back(edge{e.from == old_index ? new_index : e.from,
+					                          e.to == old_index ? new_index : e.to,
+					                          std::move(e.weight)});
+				}
+				else {
+					if (kept != i) {
+						edges_[kept] = std::move(e);
+					}
+					++kept;
+				}
+			}
+			edges_.erase(edges_.begin() + static_cast<std::ptrdiff_t>(kept), edges_.end());
+			std::sort(redirected.begin(), redirected.end(), edge_cmp{});
+			edges_.insert(edges_.end(),
+			              std::make_move_iterator(redirected.begin()),
+			              std::make_move_iterator(redirected.end()));
+			std::inplace_merge(edges_.begin(),
+			                   edges_.begin() + static_cast<std::ptrdiff_t>(kept),
+			                   edges_.end(),
+			                   edge_cmp{});
+			edges_.erase(std::unique(edges_.begin(),
+			                         edges_.end(),
+			                         [](edge const& a, edge const& b) {
+				                         return !edge_cmp{}(a, b) && !edge_cmp{}(b, a);
+			                         }),
+			             edges_.end());
+			remove_node_at(old_index);
+		}
+
+		// Complexity: O(n+e)
+		auto erase_node(N const& value) noexcept -> bool {
+			auto const index = index_of(value);
+			if (index == npos) {
+				return false;
+			}
+			edges_.erase(std::remove_if(edges_.begin(),
+			                            edges_.end(),
+			                            [index](edge const& e) {
+				                            return e.from == index || e.to == index;
+			                            }),
+			             edges_.end());
+			remove_node_at(index);
+			return true;
+		}
+
+		// Complexity: O(log(n)+e)
+		auto erase_edge(N const& src, N const& dst, E const& weight) -> bool {
+			auto const from = index_of(src);
+			auto const to = index_of(dst);
+			if (from == npos || to == npos) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::erase_edge on src or dst "
+				                         "if "
+				                         "they don't exist in the graph");
+			}
+			auto iter = find_edge(from, to, weight);
+			if (iter == edges_.end()) {
+				return false;
+			}
+			edges_.erase(iter);
+			return true;
+		}
+
+		auto clear() noexcept -> void {
+			nodes_.clear();
+			edges_.clear();
+		}
+
+		// Complexity: O(log(n))
+		[[nodiscard]] auto is_node(N const& value) const noexcept -> bool {
+			return index_of(value) != npos;
+		}
+
+		[[nodiscard]] auto empty() const noexcept -> bool {
+			return nodes_.empty();
+		}
+
+		// Complexity: O(log(n)+log(e))
+		[[nodiscard]] auto is_connected(N const& src, N const& dst) const -> bool {
+			auto const from = index_of(src);
+			auto const to = index_of(dst);
+			if (from == npos || to == npos) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::is_connected if src or dst "
+				                         "node don't exist in the graph");
+			}
+			auto const [first, last] = edges_between(from, to);
+			return first != last;
+		}
+
+		// Complexity: O(n)
+		[[nodiscard]] auto nodes() const noexcept -> std::vector<N> {
+			return nodes_;
+		}
+
+		// Complexity: O(log(n)+log(e)+k) - k is the number of weights returned
+		[[nodiscard]] auto weights(N const& src, N const& dst) const -> std::vector<E> {
+			auto const from = index_of(src);
+			auto const to = index_of(dst);
+			if (from == npos || to == npos) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::weights if src or dst node "
+				                         "don't exist in the graph");
+			}
+			auto vec_weights = std::vector<E>();
+			auto const [first, last] = edges_between(from, to);
+			std::transform(first, last, std::back_inserter(vec_weights), [](edge const& e) {
+				return e.weight;
+			});
+			return vec_weights;
+		}
+
+		// Complexity: O(log(n)+log(e)+d) - d is the number of edges from src
+		[[nodiscard]] auto connections(N const& src) const -> std::vector<N> {
+			auto const from = index_of(src);
+			if (from == npos) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::connections if src doesn't "
+				                         "exist in "
+				                         "the graph");
+			}
+			auto vec_dsts = std::vector<N>();
+			auto const [first, last] = edges_from(from);
+			// the edges are sorted by dst, so duplicates are adjacent
+			for (auto iter = first; iter != last; ++iter) {
+				if (iter == first || std::prev(iter)->to != iter->to) {
+					vec_dsts.push_back(nodes_[iter->to]);
+				}
+			}
+			return vec_dsts;
+		}
+
+		// Complexity: O(n+e)
+		[[nodiscard]] auto operator==(flat_graph const& other) const noexcept -> bool {
+			// equal node arrays give equal positions, so the edges compare directly
+			return nodes_.size() == other.nodes_.size() && edges_.size() == other.edges_.size()
+			       && std::equal(nodes_.begin(), nodes_.end(), other.nodes_.begin())
+			       && std::equal(edges_.begin(),
+			                     edges_.end(),
+			                     other.edges_.begin(),
+			                     [](edge const& lhs, edge const& rhs) {
+				                     return lhs.from == rhs.from && lhs.to == rhs.to
+				                            && lhs.weight == rhs.weight;
+			                     });
+		}
+
+		friend auto operator<<(std::ostream& os, flat_graph const& g) -> std::ostream& {
+			auto iter = g.edges_.begin();
+			for (auto from = std::size_t{0}; from < g.nodes_.size(); ++from) {
+				os << g.nodes_[from] << " (\n";
+				for (; iter != g.edges_.end() && iter->from == from; ++iter) {
+					os << "  " << g.nodes_[iter->to] << " | " << iter->weight << "\n";
+				}
+				os << ")\n";
+			}
+			return os;
+		}
+
+	private:
+		static constexpr auto npos = static_cast<std::size_t>(-1);
+
+		struct edge {
+			std::size_t from;
+			std::size_t to;
+			E weight;
+		};
+
+		// an edge to search for, without copying the weight
+		struct key {
+			std::size_t from;
+			std::size_t to;
+			E const* weight;
+		};
+
+		struct edge_cmp {
+			auto operator()(edge const& a, edge const& b) const -> bool {
+				if (a.from != b.from || a.to != b.to) {
+					return std::tie(a.from, a.to) < std::tie(b.from, b.to);
+				}
+				return a.weight < b.weight;
+			}
+
+			auto operator()(edge const& a, key const& b) const -> bool {
+				if (a.from != b.from || a.to != b.to) {
+					return std::tie(a.from, a.to) < std::tie(b.from, b.to);
+				}
+				return a.weight < *b.weight;
+			}
+
+			auto operator()(key const& a, edge const& b) const -> bool {
+				if (a.from != b.from || a.to != b.to) {
+					return std::tie(a.from, a.to) < std::tie(b.from, b.to);
+				}
+				return *a.weight < b.weight;
+			}
+		};
+
+		std::vector<N> nodes_;
+		std::vector<edge> edges_;
+
+		// position of value in nodes_, or npos
+		// Complexity: O(log(n))
+		[[nodiscard]] auto index_of(N const& value) const -> std::size_t {
+			auto iter = std::lower_bound(nodes_.begin(), nodes_.end(), value);
+			if (iter == nodes_.end() || value < *iter) {
+				return npos;
+			}
+			return static_cast<std::size_t>(iter - nodes_.begin());
+		}
+
+		// Complexity: O(log(e))
+		[[nodiscard]] auto edges_from(std::size_t from) const {
+			auto const first = std::partition_point(edges_.begin(),
+			                                        edges_.end(),
+			                                        [from](edge const& e) { return e.from < from; });
+			auto const last = std::partition_point(first, edges_.end(), [from](edge const& e) {
+				return e.from == from;
+			});
+			return std::pair(first, last);
+		}
+
+		// Complexity: O(log(e))
+		[[nodiscard]] auto edges_between(std::size_t from, std::size_t to) const {
+			auto const first =
+			   std::partition_point(edges_.begin(), edges_.end(), [from, to](edge const& e) {
+				   return std::tie(e.from, e.to) < std::tie(from, to);
+			   });
+			auto const last = std::partition_point(first, edges_.end(), [from, to](edge const& e) {
+				return e.from == from && e.to == to;
+			});
+			return std::pair(first, last);
+		}
+
+		// first edge not ordered before {from, to, weight}
+		// Complexity: O(log(e))
+		[[nodiscard]] auto edge_lower_bound(std::size_t from, std::size_t to, E const& weight) const
+		   -> typename std::vector<edge>::const_iterator {
+			return std::lower_bound(edges_.begin(), edges_.end(), key{from, to, &weight}, edge_cmp{});
+		}
+
+		// Complexity: O(log(e))
+		[[nodiscard]] auto find_edge(std::size_t from, std::size_t to, E const& weight) const
+		   -> typename std::vector<edge>::const_iterator {
+			auto const iter = edge_lower_bound(from, to, weight);
+			if (iter == edges_.end() || edge_cmp{}(key{from, to, &weight}, *iter)) {
+				return edges_.end();
+			}
+			return iter;
+		}
+
+		// erase nodes_[index], which must have no edges left,
+		// and move the positions of the nodes after it down by one
+		// Complexity: O(n+e)
+		auto remove_node_at(std::size_t index) -> void {
+			nodes_.erase(nodes_.begin() + static_cast<std::ptrdiff_t>(index));
+			for (auto& e : edges_) {
+				e.from -= e.from > index ? 1 : 0;
+				e.to -= e.to > index ? 1 : 0;
+			}
+		}
+
+	public:
+		// an edge is identified by its position in edges_,
+		// so the iterator is just the graph and an index
+		class iterator {
+		public:
+			// iterator traits
+			using value_type = flat_graph<N, E>::value_type;
+			using reference = value_type;
+			using pointer = void;
+			using difference_type = std::ptrdiff_t;
+			using iterator_category = std::bidirectional_iterator_tag;
+
+			// Iterator constructor
+			iterator() = default;
+
+			// Iterator source
+			auto operator*() const -> reference {
+				auto const& e = graph_->edges_[index_];
+				return value_type{graph_->nodes_[e.from], graph_->nodes_[e.to], e.weight};
+			}
+
+			// Iterator traversal
+			auto operator++() -> iterator& {
+				++index_;
+				return *this;
+			}
+
+			auto operator++(int) -> iterator {
+				auto copy = *this;
+				++*this;
+				return copy;
+			}
+
+			auto operator--() -> iterator& {
+				--index_;
+				return *this;
+			}
+
+			auto operator--(int) -> iterator {
+				auto copy = *this;
+				--*this;
+				return copy;
+			}
+
+			// Iterator comparison
+			friend auto operator==(iterator const& lhs, iterator const& rhs) -> bool {
+				return lhs.index_ == rhs.index_;
+			}
+
+		private:
+			flat_graph const* graph_ = nullptr;
+			std::size_t index_ = 0;
+
+			explicit iterator(flat_graph const* graph, std::size_t index) noexcept
+			: graph_(graph)
+			, index_(index) {}
+
+			friend class flat_graph<N, E>;
+		};
+
+		// Complexity: O(e)
+		auto erase_edge(iterator i) noexcept -> iterator {
+			edges_.erase(edges_.begin() + static_cast<std::ptrdiff_t>(i.index_));
+			// the next edge has moved into position i
+			return i;
+		}
+
+		// Complexity: O(e), the whole range is removed in one shift
+		auto erase_edge(iterator i, iterator s) noexcept -> iterator {
+			edges_.erase(edges_.begin() + static_cast<std::ptrdiff_t>(i.index_),
+			             edges_.begin() + static_cast<std::ptrdiff_t>(s.index_));
+			return i;
+		}
+
+		[[nodiscard]] auto begin() const -> iterator {
+			return iterator(this, 0);
+		}
+
+		[[nodiscard]] auto end() const -> iterator {
+			return iterator(this, edges_.size());
+		}
+
+		// Complexity: O(log(n)+log(e))
+		[[nodiscard]] auto find(N const& src, N const& dst, E const& weight) const noexcept
+		   -> iterator {
+			auto const from = index_of(src);
+			auto const to = index_of(dst);
+			if (from == npos || to == npos) {
+				return end();
+			}
+			auto const iter = find_edge(from, to, weight);
+			return iterator(this, static_cast<std::size_t>(iter - edges_.begin()));
+		}
+	};
+} // namespace gdwg
+#endif // GDWG_FLAT_GRAPH_HPP
@@ -0,0 +1,167 @@
+#include "gdwg/flat_graph.hpp"
+#include "gdwg/graph.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace {
+	using edge_tuple = std::tuple<std::string, std::string, int>;
+
+	template<typename G>
+	auto edges_of(G const& g) -> std::vector<edge_tuple> {
+		auto edges = std::vector<edge_tuple>();
+		for (auto const& [from, to, weight] : g) {
+			edges.emplace_back(from, to, weight);
+		}
+		return edges;
+	}
+
+	template<typename G>
+	auto edges_backwards(G const& g) -> std::vector<edge_tuple> {
+		auto edges = std::vector<edge_tuple>();
+		for (auto it = g.end(); it != g.begin();) {
+			--it;
+			auto const& [from, to, weight] = *it;
+			edges.emplace(edges.begin(), from, to, weight);
+		}
+		return edges;
+	}
+
+	template<typename G>
+	auto print(G const& g) -> std::string {
+		auto os = std::ostringstream();
+		os << g;
+		return os.str();
+	}
+
+	// runs f on g and returns what it returned, or that it threw
+	template<typename G, typename F>
+	auto outcome(G& g, F f) -> std::pair<bool, bool> {
+		try {
+			return {f(g), false};
+		} catch (std::runtime_error const&) {
+			return {false, true};
+		}
+	}
+
+	template<typename F>
+	auto same_outcome(gdwg::graph<std::string, int>& a, gdwg::flat_graph<std::string, int>& b, F f)
+	   -> void {
+		CHECK(outcome(a, f) == outcome(b, f));
+	}
+} // namespace
+
+TEST_CASE("flat_graph behaves like graph under random operations") {
+	auto engine = std::mt19937(5);
+	auto const name = [&engine] { return std::string(1, static_cast<char>('a' + engine() % 12)); };
+	for (auto round = 0; round < 40; ++round) {
+		auto a = gdwg::graph<std::string, int>{"c", "a"};
+		auto b = gdwg::flat_graph<std::string, int>{"c", "a", "c"};
+		for (auto op = 0; op < 150; ++op) {
+			auto const src = name();
+			auto const dst = name();
+			auto const weight = static_cast<int>(engine() % 4);
+			switch (engine() % 8) {
+			case 0: CHECK(a.insert_node(src) == b.insert_node(src)); break;
+			case 1:
+			case 2:
+			case 3:
+				same_outcome(a, b, [&](auto& g) { return g.insert_edge(src, dst, weight); });
+				break;
+			case 4: CHECK(a.erase_node(src) == b.erase_node(src)); break;
+			case 5:
+				if (a.is_node(src) and a.is_node(dst)) {
+					a.merge_replace_node(src, dst);
+					b.merge_replace_node(src, dst);
+				}
+				break;
+			case 6:
+				same_outcome(a, b, [&](auto& g) { return g.replace_node(src, dst); });
+				break;
+			case 7:
+				same_outcome(a, b, [&](auto& g) { return g.erase_edge(src, dst, weight); });
+				same_outcome(a, b, [&](auto& g) { return g.is_connected(src, dst); });
+				if (a.is_node(src) and a.is_node(dst)) {
+					CHECK(a.weights(src, dst) == b.weights(src, dst));
+					CHECK(a.connections(src) == b.connections(src));
+					CHECK((a.find(src, dst, weight) == a.end()) == (b.find(src, dst, weight) == b.end()));
+				}
+				break;
+			}
+			REQUIRE(a.nodes() == b.nodes());
+			REQUIRE(edges_of(a) == edges_of(b));
+		}
+		CHECK(edges_backwards(a) == edges_of(a));
+		CHECK(edges_backwards(b) == edges_of(b));
+		CHECK(print(a) == print(b));
+	}
+}
+
+TEST_CASE("merge_replace_node redirects incoming edges and drops duplicates") {
+	auto const check = [](auto g) {
+		for (auto const& [from, to, weight] : std::vector<edge_tuple>{{"a", "b", 1},
+		                                                              {"b", "a", 2},
+		                                                              {"a", "a", 3},
+		                                                              {"c", "a", 1},
+		                                                              {"c", "b", 1},
+		                                                              {"b", "b", 3}}) {
+			g.insert_edge(from, to, weight);
+		}
+		g.merge_replace_node("a", "b");
+		CHECK(!g.is_node("a"));
+		CHECK(edges_of(g) == std::vector<edge_tuple>{{"b", "b", 1}, {"b", "b", 2}, {"b", "b", 3}, {"c", "b", 1}});
+
+		// merging a node into itself changes nothing
+		g.merge_replace_node("b", "b");
+		CHECK(edges_of(g).size() == 4);
+
+		CHECK(g.erase_node("b"));
+		CHECK(edges_of(g).empty());
+		CHECK(g.nodes() == std::vector<std::string>{"c"});
+	};
+	check(gdwg::graph<std::string, int>{"a", "b", "c"});
+	check(gdwg::flat_graph<std::string, int>{"a", "b", "c"});
+}
+
+TEST_CASE("flat_graph has graph's exception specifications") {
+	using graph = gdwg::graph<std::string, int>;
+	using flat_graph = gdwg::flat_graph<std::string, int>;
+	// only named inside noexcept(), nothing is called
+	auto g = graph();
+	auto f = flat_graph();
+	auto const n = std::string();
+	auto const w = 0;
+	STATIC_REQUIRE(noexcept(g.insert_node(n)) == noexcept(f.insert_node(n)));
+	STATIC_REQUIRE(noexcept(g.insert_edge(n, n, w)) == noexcept(f.insert_edge(n, n, w)));
+	STATIC_REQUIRE(noexcept(g.replace_node(n, n)) == noexcept(f.replace_node(n, n)));
+	STATIC_REQUIRE(noexcept(g.merge_replace_node(n, n)) == noexcept(f.merge_replace_node(n, n)));
+	STATIC_REQUIRE(noexcept(g.erase_node(n)) == noexcept(f.erase_node(n)));
+	STATIC_REQUIRE(noexcept(g.erase_edge(n, n, w)) == noexcept(f.erase_edge(n, n, w)));
+	STATIC_REQUIRE(noexcept(g.erase_edge(g.begin())) == noexcept(f.erase_edge(f.begin())));
+	STATIC_REQUIRE(noexcept(g.erase_edge(g.begin(), g.end()))
+	               == noexcept(f.erase_edge(f.begin(), f.end())));
+	STATIC_REQUIRE(noexcept(g.clear()) == noexcept(f.clear()));
+	STATIC_REQUIRE(noexcept(g.is_node(n)) == noexcept(f.is_node(n)));
+	STATIC_REQUIRE(noexcept(g.empty()) == noexcept(f.empty()));
+	STATIC_REQUIRE(noexcept(g.is_connected(n, n)) == noexcept(f.is_connected(n, n)));
+	STATIC_REQUIRE(noexcept(g.nodes()) == noexcept(f.nodes()));
+	STATIC_REQUIRE(noexcept(g.weights(n, n)) == noexcept(f.weights(n, n)));
+	STATIC_REQUIRE(noexcept(g.find(n, n, w)) == noexcept(f.find(n, n, w)));
+	STATIC_REQUIRE(noexcept(g.connections(n)) == noexcept(f.connections(n)));
+	STATIC_REQUIRE(noexcept(g == g) == noexcept(f == f));
+	STATIC_REQUIRE(std::is_nothrow_copy_constructible_v<graph>
+	               == std::is_nothrow_copy_constructible_v<flat_graph>);
+	STATIC_REQUIRE(std::is_nothrow_copy_assignable_v<graph>
+	               == std::is_nothrow_copy_assignable_v<flat_graph>);
+	STATIC_REQUIRE(std::is_nothrow_move_constructible_v<graph>
+	               == std::is_nothrow_move_constructible_v<flat_graph>);
+	STATIC_REQUIRE(std::is_nothrow_move_assignable_v<graph>
+	               == std::is_nothrow_move_assignable_v<flat_graph>);
+}
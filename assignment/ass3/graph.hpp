@@ -2,8 +2,10 @@
 #define GDWG_GRAPH_HPP
 
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <map>
 #include <memory>
 #include <set>
@@ -32,7 +34,7 @@ namespace gdwg {
 		template<typename InputIt>
 		graph(InputIt first, InputIt last) {
 			for (auto& it = first; it != last; ++it) {
-				nodes_.emplace(std::make_shared<N>(*it));
+				insert_node(*it);
 			}
 		}
 
@@ -40,6 +42,7 @@ namespace gdwg {
 		graph(graph&& other) noexcept {
 			nodes_ = std::move(other.nodes_);
 			edges_ = std::move(other.edges_);
+			incoming_ = std::move(other.incoming_);
 			weights_ = std::move(other.weights_);
 		}
 
@@ -53,7 +56,7 @@ namespace gdwg {
 			nodes_.clear();
 			edges_.clear();
 			std::for_each(other.nodes_.begin(), other.nodes_.end(), [this](auto const& v) {
-				insert_node(*v);
+				insert_node(v->value);
 			});
 
 			weights_.clear();
@@ -63,7 +66,7 @@ namespace gdwg {
 
 			std::for_each(other.edges_.begin(), other.edges_.end(), [this](auto const& v) {
 				std::for_each(v.second.begin(), v.second.end(), [this, v](auto const& e) {
-					insert_edge(*(v.first), *(e.to), *(e.weight));
+					insert_edge(v.first->value, e.to->value, *(e.weight));
 				});
 			});
 		}
@@ -76,52 +79,98 @@ namespace gdwg {
 
 		auto insert_node(N const& value) noexcept -> bool {
 			if (!is_node(value)) {
-				nodes_.emplace(std::make_shared<N>(value));
+				auto iter = nodes_.emplace(std::make_shared<node>(node{value, 0})).first;
+				assign_key(iter);
 				return true;
 			}
 			return false;
 		}
 
 		auto insert_edge(N const& src, N const& dst, E const& weight) -> bool {
-			if (!is_node(src) || !is_node(dst)) {
+			auto const src_iter = nodes_.find(src);
+			auto const dst_iter = nodes_.find(dst);
+			if (src_iter == nodes_.end() || dst_iter == nodes_.end()) {
 				throw std::runtime_error("Cannot call gdwg::graph<N, E>::insert_edge when either src "
 				                         "or dst node does not exist");
 			}
 
 			// Create new_edge for inserting
-			auto another_dst = nodes_.find(dst);
-			auto new_edge = edge{};
-			new_edge.to = *another_dst;
-
-			// If the weight is new, create a base resource for it
-			auto another_weight = weights_.find(weight);
-			if (another_weight != weights_.end()) {
-				new_edge.weight = *another_weight;
+			// from here on src and dst are compared by key, not by value
+			auto new_edge = edge{*dst_iter, intern_weight(weight)};
+
+			// Complexity: O(log(n)+log(e))
+			// the src's edge set is created if this is its first edge,
+			// and a duplicate edge is detected by the insert itself
+			auto map_iter = edges_.try_emplace(*src_iter).first;
+			if (!map_iter->second.insert(new_edge).second) {
+				return false;
 			}
-			else {
-				auto new_weight = std::make_shared<E>(weight);
-				weights_.emplace(new_weight);
-				new_edge.weight = new_weight;
+			++incoming_[new_edge.to][*src_iter];
+			return true;
+		}
+
+		// insert every value_type {from, to, weight} in edges, returns how many were new
+		// the weights are copied, since a range like graph yields its edges by value
+		// throws like insert_edge if a node is missing, before the graph is changed
+		// the edges are sorted once and then merged into each src's edge set in one
+		// forward walk, so loading k edges into a set of d edges costs O(d+k)
+		// instead of O(k log(d))
+		template<typename Range>
+		auto insert_edges(Range const& edges) -> std::size_t {
+			struct pending {
+				node_ptr from;
+				node_ptr to;
+				E weight;
+			};
+			auto resolved = std::vector<pending>();
+			for (auto const& e : edges) {
+				auto src_iter = nodes_.find(e.from);
+				auto dst_iter = nodes_.find(e.to);
+				if (src_iter == nodes_.end() || dst_iter == nodes_.end()) {
+					throw std::runtime_error("Cannot call gdwg::graph<N, E>::insert_edges when either "
+					                         "src or dst node does not exist");
+				}
+				resolved.push_back(pending{*src_iter, *dst_iter, e.weight});
 			}
 
-			auto map_iter = edges_.find(src);
-			// if in edges_ map, the incoming src node is first time added
-			// I need to create the key and the set
-			if (map_iter == edges_.end()) {
-				auto node_iter = nodes_.find(src);
-				std::set<edge, edge_cmp> empty_set = {new_edge};
-				edges_.emplace(*node_iter, empty_set);
-			}
-			else { // else I insert into the set of edges under the src node
-				auto src_out_edges = map_iter->second;
-				value_type edge_to_find = {src, dst, weight};
-				auto iter = src_out_edges.find(edge_to_find);
-				if (iter != src_out_edges.end()) {
-					return false;
+			auto const less = [](pending const& a, pending const& b) {
+				if (a.from != b.from) {
+					return a.from->key < b.from->key;
+				}
+				if (a.to != b.to) {
+					return a.to->key < b.to->key;
+				}
+				return a.weight < b.weight;
+			};
+			std::sort(resolved.begin(), resolved.end(), less);
+			resolved.erase(std::unique(resolved.begin(),
+			                           resolved.end(),
+			                           [&less](auto const& a, auto const& b) {
+				                           return !less(a, b) && !less(b, a);
+			                           }),
+			               resolved.end());
+
+			auto inserted = std::size_t{0};
+			for (auto first = resolved.begin(); first != resolved.end();) {
+				auto const& src = first->from;
+				auto& out_edges = edges_.try_emplace(src).first->second;
+				// hint is the first existing edge not ordered before the current new edge,
+				// it only moves forward because the new edges are sorted
+				auto hint = out_edges.lower_bound(edge_key{first->to->key, &first->weight});
+				for (; first != resolved.end() && first->from == src; ++first) {
+					auto const key = edge_key{first->to->key, &first->weight};
+					while (hint != out_edges.end() && edge_cmp{}(*hint, key)) {
+						++hint;
+					}
+					if (hint != out_edges.end() && !edge_cmp{}(key, *hint)) {
+						continue;
+					}
+					out_edges.emplace_hint(hint, edge{first->to, intern_weight(first->weight)});
+					++incoming_[first->to][src];
+					++inserted;
 				}
-				map_iter->second.emplace(new_edge);
 			}
-			return true;
+			return inserted;
 		}
 
 		auto replace_node(N const& old_data, N const& new_data) -> bool {
@@ -140,48 +189,45 @@ namespace gdwg {
 		}
 
 		auto merge_replace_node(N const& old_data, N const& new_data) -> void {
-			if (!is_node(old_data) || !is_node(new_data)) {
+			auto const old_iter = nodes_.find(old_data);
+			auto const new_iter = nodes_.find(new_data);
+			if (old_iter == nodes_.end() || new_iter == nodes_.end()) {
 				throw std::runtime_error("Cannot call gdwg::graph<N, E>::merge_replace_node on old or "
 				                         "new data if they don't exist in the graph");
 			}
 
-			for (auto map_iter = edges_.begin(); map_iter != edges_.end();) {
-				// three cases
-				// 1. for an edge, both src and dst are old data
-				// 2. for an edge, src is the old data
-				// 3. for an edge, dst is the old data
-				// In order to keep the right order,
-				// I insert new edge and delete the old one
-				for (auto old_edge = map_iter->second.begin(); old_edge != map_iter->second.end();) {
-					if (*map_iter->first == old_data && *old_edge->to == old_data) {
-						insert_edge(new_data, new_data, *old_edge->weight);
-						old_edge = map_iter->second.erase(old_edge);
-					}
-					else if (*map_iter->first == old_data) {
-						insert_edge(new_data, *old_edge->to, *old_edge->weight);
-						old_edge = map_iter->second.erase(old_edge);
-					}
-					else if (*old_edge->to == old_data) {
-						insert_edge(*map_iter->first, new_data, *old_edge->weight);
-						old_edge = map_iter->second.erase(old_edge);
-					}
-					else {
-						++old_edge;
-					}
-				}
-				// if this src does not have edges,
-				// erase it from map
-				if (map_iter->second.empty()) {
-					map_iter = edges_.erase(map_iter);
+			auto const old_node = *old_iter;
+			auto const new_node = *new_iter;
+			if (old_node == new_node) {
+				return;
+			}
+			// Complexity: O(d log(n+d)) - d is the number of edges touching old_data
+			// collect the edges of old_data with old_data replaced by new_data,
+			// remove old_data, then insert them, duplicates are dropped by insert_edge
+			auto redirected = std::vector<value_type>();
+			if (auto map_iter = edges_.find(old_node); map_iter != edges_.end()) {
+				for (auto const& e : map_iter->second) {
+					auto const& to = e.to == old_node ? new_data : e.to->value;
+					redirected.push_back(value_type{new_data, to, *e.weight});
 				}
-				else {
-					++map_iter;
+			}
+			if (auto in_iter = incoming_.find(old_node); in_iter != incoming_.end()) {
+				for (auto const& src : in_iter->second) {
+					// self loops were collected with the outgoing edges
+					if (src.first == old_node) {
+						continue;
+					}
+					auto [first, last] = edges_.find(src.first)->second.equal_range(old_node->key);
+					std::for_each(first, last, [&redirected, &src, &new_data](auto const& e) {
+						redirected.push_back(value_type{src.first->value, new_data, *e.weight});
+					});
 				}
 			}
-			// after done with the edges map
-			// I need to delete the old node as well
-			auto old_data_it = nodes_.find(old_data);
-			nodes_.erase(old_data_it);
+			disconnect(old_node);
+			nodes_.erase(old_iter);
+			for (auto const& e : redirected) {
+				insert_edge(e.from, e.to, e.weight);
+			}
 		}
 
 		auto erase_node(N const& value) noexcept -> bool {
@@ -189,41 +235,25 @@ namespace gdwg {
 			if (old_data_it == nodes_.end()) {
 				return false;
 			}
+			// Complexity: O(d log(n+d)) - d is the number of edges touching value
+			disconnect(*old_data_it);
 			nodes_.erase(old_data_it);
-			// I need to loop through the edges map
-			// to delete any edges with node value involved
-			for (auto map_iter = edges_.begin(); map_iter != edges_.end();) {
-				for (auto old_edge = map_iter->second.begin(); old_edge != map_iter->second.end();) {
-					if (*map_iter->first == value || *old_edge->to == value) {
-						old_edge = map_iter->second.erase(old_edge);
-					}
-					else {
-						++old_edge;
-					}
-				}
-				// if this src key have no edges in its edge set
-				// I need to delete the key from edges map as well because it does not have edges
-				if (map_iter->second.empty()) {
-					map_iter = edges_.erase(map_iter);
-				}
-				else {
-					++map_iter;
-				}
-			}
 			return true;
 		}
 
 		// Complexity: log(n)+log(e)
 		auto erase_edge(N const& src, N const& dst, E const& weight) -> bool {
-			if (!is_node(src) || !is_node(dst)) {
+			auto const src_iter = nodes_.find(src);
+			auto const dst_iter = nodes_.find(dst);
+			if (src_iter == nodes_.end() || dst_iter == nodes_.end()) {
 				throw std::runtime_error("Cannot call gdwg::graph<N, E>::erase_edge on src or dst "
 				                         "if "
 				                         "they don't exist in the graph");
 			}
-			// create a value type for searching in edge set of a src key
-			value_type edge_to_find = {src, dst, weight};
+			// create a key for searching in edge set of a src key
+			auto edge_to_find = edge_key{(*dst_iter)->key, &weight};
 			// Complexity: log(n) - n is the number of stored nodes
-			auto map_iter = edges_.find(src);
+			auto map_iter = edges_.find(*src_iter);
 			// if the src map does not have edges
 			// return false
 			if (map_iter == edges_.end()) {
@@ -234,6 +264,7 @@ namespace gdwg {
 			if (iter == map_iter->second.end()) {
 				return false;
 			}
+			forget_incoming(map_iter->first, iter->to);
 			map_iter->second.erase(iter);
 			// if the last edge of this src is deleted
 			// delete the src from the edges map as well
@@ -246,6 +277,7 @@ namespace gdwg {
 		auto clear() noexcept -> void {
 			nodes_.clear();
 			edges_.clear();
+			incoming_.clear();
 			weights_.clear();
 		}
 
@@ -262,13 +294,15 @@ namespace gdwg {
 
 		// Complexity: O(log(n)+log(e))
 		[[nodiscard]] auto is_connected(N const& src, N const& dst) const -> bool {
-			if (!is_node(src) || !is_node(dst)) {
+			auto const src_iter = nodes_.find(src);
+			auto const dst_iter = nodes_.find(dst);
+			if (src_iter == nodes_.end() || dst_iter == nodes_.end()) {
 				throw std::runtime_error("Cannot call gdwg::graph<N, E>::is_connected if src or dst "
 				                         "node don't exist in the graph");
 			}
 
 			// Complexity: log(n)
-			auto map_iter = edges_.find(src);
+			auto map_iter = edges_.find(*src_iter);
 			if (map_iter == edges_.end()) {
 				return false;
 			}
@@ -276,7 +310,7 @@ namespace gdwg {
 				return false;
 			}
 			// Complexity: log(e)
-			auto find_edge_iter = map_iter->second.find(dst);
+			auto find_edge_iter = map_iter->second.find((*dst_iter)->key);
 			return find_edge_iter != map_iter->second.end();
 		}
 
@@ -284,64 +318,66 @@ namespace gdwg {
 		[[nodiscard]] auto nodes() const noexcept -> std::vector<N> {
 			auto vec_nodes = std::vector<N>();
 			std::for_each(nodes_.begin(), nodes_.end(), [&vec_nodes](auto const& it) {
-				vec_nodes.push_back(*it);
+				vec_nodes.push_back(it->value);
 			});
 			return vec_nodes;
 		}
 
-		// Complexity: O(log(n) + e)
+		// Complexity: O(log(n) + log(e) + k) - k is the number of weights returned
 		[[nodiscard]] auto weights(N const& src, N const& dst) const -> std::vector<E> {
-			if (!is_node(src) || !is_node(dst)) {
+			auto const src_iter = nodes_.find(src);
+			auto const dst_iter = nodes_.find(dst);
+			if (src_iter == nodes_.end() || dst_iter == nodes_.end()) {
 				throw std::runtime_error("Cannot call gdwg::graph<N, E>::weights if src or dst node "
 				                         "don't exist in the graph");
 			}
 			auto vec_weights = std::vector<E>();
 			// Complexity: log(n)
-			auto map_iter = edges_.find(src);
+			auto map_iter = edges_.find(*src_iter);
 			if (map_iter == edges_.end()) {
 				return vec_weights;
 			}
 			if (map_iter->second.empty()) {
 				return vec_weights;
 			}
-			// Complexity: O(e) - e is the numebr of edges from src
-			std::for_each(map_iter->second.begin(),
-			              map_iter->second.end(),
-			              [&dst, &vec_weights](auto const& it) {
-				              if (*it.to == dst) {
-					              vec_weights.push_back(*it.weight);
-				              }
-				              return;
-			              });
+			// Complexity: O(log(e) + k) - the edges to dst are adjacent in the set
+			auto [first, last] = map_iter->second.equal_range((*dst_iter)->key);
+			std::for_each(first, last, [&vec_weights](auto const& it) {
+				vec_weights.push_back(*it.weight);
+			});
 
 			return vec_weights;
 		}
 
 		// Complexity: O(log(n)+e)
 		[[nodiscard]] auto connections(N const& src) const -> std::vector<N> {
-			if (!is_node(src)) {
+			auto const src_iter = nodes_.find(src);
+			if (src_iter == nodes_.end()) {
 				throw std::runtime_error("Cannot call gdwg::graph<N, E>::connections if src doesn't "
 				                         "exist in "
 				                         "the graph");
 			}
 			auto vec_dsts = std::vector<N>();
 			// Complexity: log(n)
-			auto map_iter = edges_.find(src);
+			auto map_iter = edges_.find(*src_iter);
 			if (map_iter == edges_.end()) {
 				return vec_dsts;
 			}
 			if (map_iter->second.empty()) {
 				return vec_dsts;
 			}
-			// Complexity: log(e)
-			std::for_each(map_iter->second.begin(), map_iter->second.end(), [&vec_dsts](auto const& it) {
-				// this is used for find duplicate dst
-				// because they may have different weights
-				auto f = std::find(vec_dsts.begin(), vec_dsts.end(), *it.to);
-				if (f == vec_dsts.end()) {
-					vec_dsts.push_back(*it.to);
-				}
-			});
+			// Complexity: O(e)
+			// edges are sorted by dst, so edges to the same dst
+			// with different weights are adjacent
+			auto const* previous = static_cast<node const*>(nullptr);
+			std::for_each(map_iter->second.begin(),
+			              map_iter->second.end(),
+			              [&vec_dsts, &previous](auto const& it) {
+				              if (it.to.get() != previous) {
+					              vec_dsts.push_back(it.to->value);
+					              previous = it.to.get();
+				              }
+			              });
 			return vec_dsts;
 		}
 
@@ -352,7 +388,9 @@ namespace gdwg {
 			                       nodes_.end(),
 			                       other.nodes_.begin(),
 			                       other.nodes_.end(),
-			                       [](auto const& lhs, auto const& rhs) { return *lhs == *rhs; });
+			                       [](auto const& lhs, auto const& rhs) {
+				                       return lhs->value == rhs->value;
+			                       });
 			// if nodes are different
 			// there is no need to check edges
 			if (flag) {
@@ -362,13 +400,13 @@ namespace gdwg {
 				                  other.edges_.begin(),
 				                  other.edges_.end(),
 				                  [](auto const& lhs, auto const& rhs) {
-					                  return (*(lhs.first) == *(rhs.first))
+					                  return (lhs.first->value == rhs.first->value)
 					                         && std::equal(lhs.second.begin(),
 					                                       lhs.second.end(),
 					                                       rhs.second.begin(),
 					                                       rhs.second.end(),
 					                                       [](auto const& lhs_e, auto const& rhs_e) {
-						                                       return *lhs_e.to == *rhs_e.to
+						                                       return lhs_e.to->value == rhs_e.to->value
 						                                              && *lhs_e.weight == *rhs_e.weight;
 					                                       });
 				                  });
@@ -378,10 +416,10 @@ namespace gdwg {
 
 		friend auto operator<<(std::ostream& os, graph const& g) -> std::ostream& {
 			for (auto const& src : g.nodes_) {
-				os << *src << " (\n";
-				auto vec_dsts = g.connections(*src);
+				os << src->value << " (\n";
+				auto vec_dsts = g.connections(src->value);
 				for (auto const& dst : vec_dsts) {
-					auto vec_weights = g.weights(*src, dst);
+					auto vec_weights = g.weights(src->value, dst);
 					for (auto const& weight : vec_weights) {
 						os << "  " << dst << " | " << weight << "\n";
 					}
@@ -392,69 +430,75 @@ namespace gdwg {
 		}
 
 	private:
+		// a node value and its key
+		// keys are integers in the same order as the values, so once a node has
+		// been looked up by value, the edges_ map and the edge sets only compare keys
+		struct node {
+			N value;
+			std::uint64_t key;
+		};
+
+		using node_ptr = std::shared_ptr<node>;
+
 		struct edge {
-			std::shared_ptr<N> to;
+			node_ptr to;
 			std::shared_ptr<E> weight;
 		};
 
+		// {dst, weight} to search for in an edge set
+		struct edge_key {
+			std::uint64_t to;
+			E const* weight;
+		};
+
 		struct node_cmp {
 			using is_transparent = void;
-			auto operator()(std::shared_ptr<N> const& a, std::shared_ptr<N> const& b) const noexcept
-			   -> bool {
-				return *a < *b;
+			auto operator()(node_ptr const& a, node_ptr const& b) const noexcept -> bool {
+				return a->value < b->value;
 			}
-			auto operator()(std::shared_ptr<N> const& a, N const& b) const noexcept -> bool {
-				return *a < b;
+			auto operator()(node_ptr const& a, N const& b) const noexcept -> bool {
+				return a->value < b;
 			}
-			auto operator()(N const& a, std::shared_ptr<N> const& b) const noexcept -> bool {
-				return a < *b;
+			auto operator()(N const& a, node_ptr const& b) const noexcept -> bool {
+				return a < b->value;
 			}
 		};
 
 		struct edge_map_cmp {
-			using is_transparent = void;
-			auto operator()(std::shared_ptr<N> const& a, std::shared_ptr<N> const& b) const noexcept
-			   -> bool {
-				return *a < *b;
-			}
-
-			auto operator()(std::shared_ptr<N> const& a, N const& b) const noexcept -> bool {
-				return *a < b;
-			}
-			auto operator()(N const& a, std::shared_ptr<N> const& b) const noexcept -> bool {
-				return a < *b;
+			auto operator()(node_ptr const& a, node_ptr const& b) const noexcept -> bool {
+				return a->key < b->key;
 			}
 		};
 
 		struct edge_cmp {
 			using is_transparent = void;
 			auto operator()(edge const& a, edge const& b) const noexcept -> bool {
-				if (*a.to != *b.to) {
-					return *a.to < *b.to;
+				if (a.to != b.to) {
+					return a.to->key < b.to->key;
 				}
 				return *a.weight < *b.weight;
 			}
 
-			// find for {src, dst,weight}
-			auto operator()(edge const& a, value_type const& b) const noexcept -> bool {
-				if (*a.to != b.to) {
-					return *a.to < b.to;
+			// find for {dst, weight}
+			auto operator()(edge const& a, edge_key const& b) const noexcept -> bool {
+				if (a.to->key != b.to) {
+					return a.to->key < b.to;
 				}
-				return *a.weight < b.weight;
+				return *a.weight < *b.weight;
 			}
-			auto operator()(value_type const& a, edge const& b) const noexcept -> bool {
-				if (a.to != *b.to) {
-					return a.to < *b.to;
+			auto operator()(edge_key const& a, edge const& b) const noexcept -> bool {
+				if (a.to != b.to->key) {
+					return a.to < b.to->key;
 				}
-				return a.weight < *b.weight;
+				return *a.weight < *b.weight;
 			}
 
 			// find for {dst}
-			auto operator()(edge const& a, N const& b) const noexcept -> bool {
-				return *a.to < b;
+			auto operator()(edge const& a, std::uint64_t b) const noexcept -> bool {
+				return a.to->key < b;
 			}
-			auto operator()(N const& a, edge const& b) const noexcept -> bool {
-				return a < *b.to;
+			auto operator()(std::uint64_t a, edge const& b) const noexcept -> bool {
+				return a < b.to->key;
 			}
 		};
 
@@ -471,20 +515,129 @@ namespace gdwg {
 				return a < *b;
 			}
 		};
-		std::set<std::shared_ptr<N>, node_cmp> nodes_;
-		std::map<std::shared_ptr<N>, std::set<edge, edge_cmp>, edge_map_cmp> edges_;
+		std::set<node_ptr, node_cmp> nodes_;
+		std::map<node_ptr, std::set<edge, edge_cmp>, edge_map_cmp> edges_;
+		// reverse index of edges_: dst -> each src with edges to dst,
+		// and how many edges (one per weight) go from that src to dst
+		std::map<node_ptr, std::map<node_ptr, std::size_t, edge_map_cmp>, edge_map_cmp> incoming_;
 		std::set<std::shared_ptr<E>, weight_cmp> weights_;
 
+		// the shared copy of weight, created if this is its first use
+		auto intern_weight(E const& weight) -> std::shared_ptr<E> {
+			auto another_weight = weights_.find(weight);
+			if (another_weight != weights_.end()) {
+				return *another_weight;
+			}
+			auto new_weight = std::make_shared<E>(weight);
+			weights_.emplace(new_weight);
+			return new_weight;
+		}
+
+		// record that one edge src -> dst was removed from edges_
+		auto forget_incoming(node_ptr const& src, node_ptr const& dst) noexcept -> void {
+			auto in_iter = incoming_.find(dst);
+			auto src_iter = in_iter->second.find(src);
+			if (--src_iter->second == 0) {
+				in_iter->second.erase(src_iter);
+				if (in_iter->second.empty()) {
+					incoming_.erase(in_iter);
+				}
+			}
+		}
+
+		// remove every edge from or to n
+		// incoming edges are found through incoming_, so only the edge sets
+		// of n's sources are visited instead of every edge in the graph
+		auto disconnect(node_ptr const& n) noexcept -> void {
+			if (auto map_iter = edges_.find(n); map_iter != edges_.end()) {
+				for (auto const& e : map_iter->second) {
+					forget_incoming(n, e.to);
+				}
+				edges_.erase(map_iter);
+			}
+			if (auto in_iter = incoming_.find(n); in_iter != incoming_.end()) {
+				for (auto const& src : in_iter->second) {
+					auto map_iter = edges_.find(src.first);
+					auto [first, last] = map_iter->second.equal_range(n->key);
+					map_iter->second.erase(first, last);
+					if (map_iter->second.empty()) {
+						edges_.erase(map_iter);
+					}
+				}
+				incoming_.erase(in_iter);
+			}
+		}
+
+		// keys for nodes added at either end are this far from their neighbour,
+		// so building a graph in sorted order rarely runs out of room
+		static constexpr auto key_stride = std::uint64_t{1} << 32U;
+
+		// give the newly inserted node at iter a key between its neighbours' keys
+		// when they are adjacent integers the nodes around iter are relabelled instead
+		auto assign_key(typename std::set<node_ptr, node_cmp>::iterator iter) -> void {
+			auto const has_prev = iter != nodes_.begin();
+			auto const has_next = std::next(iter) != nodes_.end();
+			auto const low = has_prev ? (*std::prev(iter))->key : std::uint64_t{0};
+			auto const high = has_next ? (*std::next(iter))->key
+			                           : std::numeric_limits<std::uint64_t>::max();
+			if (high - low >= 2) {
+				auto gap = (high - low) / 2;
+				if (!has_prev || !has_next) {
+					gap = std::min(gap, key_stride);
+				}
+				(*iter)->key = has_next && !has_prev ? high - gap : low + gap;
+				return;
+			}
+			relabel_around(iter);
+		}
+
+		// spread out the keys of a window of nodes around iter, iter included
+		// the window doubles until the keys just outside it leave a gap of more than
+		// m between each of its m nodes, so a run of inserts at the same place
+		// relabels O(log(n)) nodes each on average instead of the whole graph
+		// relabelling keeps the nodes' relative order, so the edges_ map and
+		// edge sets stay sorted
+		auto relabel_around(typename std::set<node_ptr, node_cmp>::iterator iter) -> void {
+			auto first = iter;
+			auto last = std::next(iter);
+			auto count = std::uint64_t{1};
+			for (;;) {
+				auto const whole = first == nodes_.begin() && last == nodes_.end();
+				auto const low = first != nodes_.begin() ? (*std::prev(first))->key : std::uint64_t{0};
+				auto const high = last != nodes_.end() ? (*last)->key
+				                                       : std::numeric_limits<std::uint64_t>::max();
+				auto const step = (high - low) / (count + 1);
+				if (step > count || whole) {
+					auto key = low;
+					for (auto it = first; it != last; ++it) {
+						key += step;
+						(*it)->key = key;
+					}
+					return;
+				}
+				auto const grow = count;
+				for (auto i = grow; i > 0 && first != nodes_.begin(); --i) {
+					--first;
+					++count;
+				}
+				for (auto i = grow; i > 0 && last != nodes_.end(); --i) {
+					++last;
+					++count;
+				}
+			}
+		}
+
 		auto swap(graph& other) -> void {
 			std::swap(nodes_, other.nodes_);
 			std::swap(edges_, other.edges_);
+			std::swap(incoming_, other.incoming_);
 			std::swap(weights_, other.weights_);
 		}
 
 	public:
 		class iterator {
 			using map_iterator =
-			   typename std::map<std::shared_ptr<N>, std::set<edge, edge_cmp>, edge_map_cmp>::const_iterator;
+			   typename std::map<node_ptr, std::set<edge, edge_cmp>, edge_map_cmp>::const_iterator;
 
 			using set_iterator = typename std::set<edge, edge_cmp>::const_iterator;
 
@@ -507,7 +660,7 @@ namespace gdwg {
 
 			// Iterator source
 			auto operator*() const -> reference {
-				return value_type{*map_iter_->first, *set_iter_->to, *set_iter_->weight};
+				return value_type{map_iter_->first->value, set_iter_->to->value, *set_iter_->weight};
 			}
 
 			// Iterator traversal
@@ -566,6 +719,7 @@ namespace gdwg {
 			auto to_erase_map_iter = copy.map_iter_;
 			auto to_erase_set_iter = copy.set_iter_;
 			auto key = (*to_erase_map_iter).first;
+			forget_incoming(key, to_erase_set_iter->to);
 			edges_[key].erase(to_erase_set_iter);
 			// If it is the last edge I erased for src
 			// Delete this src key from edges map as well
@@ -599,9 +753,14 @@ namespace gdwg {
 		// Complexity: O(log(n)+log(e))
 		[[nodiscard]] auto find(N const& src, N const& dst, E const& weight) const noexcept
 		   -> iterator {
-			value_type edge_to_find = {src, dst, weight};
+			auto src_iter = nodes_.find(src);
+			auto dst_iter = nodes_.find(dst);
+			if (src_iter == nodes_.end() || dst_iter == nodes_.end()) {
+				return end();
+			}
+			auto edge_to_find = edge_key{(*dst_iter)->key, &weight};
 			// Complexity: log(n)
-			auto map_iter = edges_.find(src);
+			auto map_iter = edges_.find(*src_iter);
 			if (map_iter == edges_.end()) {
 				return end();
 			}
@@ -0,0 +1,88 @@
+// gdwg::graph operations on a large random graph
+// usage: graph_bench [nodes] [edges] > results.json
+// defaults to 100000 nodes and 1000000 edges; each operation is timed over
+// a batch of calls and reported in microseconds per call
+#include "gdwg/graph.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	struct result {
+		std::string operation;
+		int calls;
+		double us_per_call;
+	};
+
+	template<typename F>
+	auto time_calls(int calls, F f) -> double {
+		auto const start = std::chrono::steady_clock::now();
+		for (auto i = 0; i < calls; ++i) {
+			f(i);
+		}
+		auto const elapsed = std::chrono::steady_clock::now() - start;
+		return std::chrono::duration<double, std::micro>(elapsed).count() / calls;
+	}
+
+	auto run(int nodes, int edges) -> std::vector<result> {
+		using graph = gdwg::graph<int, int>;
+		auto results = std::vector<result>();
+		auto g = graph();
+		auto const insert_nodes = time_calls(nodes, [&g](int n) { g.insert_node(n); });
+		results.push_back({"insert_node", nodes, insert_nodes});
+
+		auto engine = std::mt19937(1);
+		auto random_edges = std::vector<graph::value_type>();
+		random_edges.reserve(static_cast<std::size_t>(edges));
+		for (auto e = 0; e < edges; ++e) {
+			auto const from = static_cast<int>(engine() % static_cast<unsigned>(nodes));
+			auto const to = static_cast<int>(engine() % static_cast<unsigned>(nodes));
+			random_edges.push_back({from, to, static_cast<int>(engine() % 10)});
+		}
+		// the second half goes through insert_edge, one call per edge
+		auto const half = random_edges.size() / 2;
+		auto const first_half = std::vector<graph::value_type>(
+		   random_edges.begin(),
+		   random_edges.begin() + static_cast<std::ptrdiff_t>(half));
+		auto const bulk = time_calls(1, [&](int) { g.insert_edges(first_half); });
+		results.push_back({"insert_edges", 1, bulk});
+		auto const single = time_calls(static_cast<int>(random_edges.size() - half), [&](int i) {
+			auto const& e = random_edges[half + static_cast<std::size_t>(i)];
+			g.insert_edge(e.from, e.to, e.weight);
+		});
+		results.push_back({"insert_edge", static_cast<int>(random_edges.size() - half), single});
+
+		// erase nodes [0, calls), then merge nodes from [calls, 3 * calls) into the
+		// last `calls` nodes, calls <= nodes / 4 keeps the two ranges apart
+		auto const calls = std::min(2000, nodes / 4);
+		results.push_back({"erase_node", calls, time_calls(calls, [&g](int i) { g.erase_node(i); })});
+		results.push_back({"merge_replace_node", calls, time_calls(calls, [&g, nodes, calls](int i) {
+			                   g.merge_replace_node(calls + 2 * i, nodes - 1 - i);
+		                   })});
+		return results;
+	}
+} // namespace
+
+auto main(int argc, char** argv) -> int {
+	auto const nodes = argc > 1 ? std::atoi(argv[1]) : 100000;
+	auto const edges = argc > 2 ? std::atoi(argv[2]) : 1000000;
+	auto const results = run(nodes, edges);
+
+	std::printf("{\n  \"nodes\": %d,\n  \"edges\": %d,\n  \"benchmarks\": [\n", nodes, edges);
+	for (auto i = std::size_t{0}; i < results.size(); ++i) {
+		auto const& r = results[i];
+		std::printf("    {\"operation\": \"%s\", \"calls\": %d, \"us_per_call\": %.3f}%s\n",
+		            r.operation.c_str(),
+		            r.calls,
+		            r.us_per_call,
+		            i + 1 == results.size() ? "" : ",");
+	}
+	std::printf("  ]\n}\n");
+	return 0;
+}
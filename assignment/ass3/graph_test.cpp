@@ -0,0 +1,112 @@
+#include "gdwg/graph.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// inserting before the same node over and over runs out of keys between
+// its neighbours, the nodes around it are relabelled without reordering them
+TEST_CASE("node keys are relabelled when their neighbours run out of room") {
+	auto g = gdwg::graph<int, int>();
+	g.insert_node(INT_MAX);
+	auto const n = 5000;
+	for (auto i = 0; i < n; ++i) {
+		CHECK(g.insert_node(i));
+		g.insert_edge(i, INT_MAX, i);
+		if (i > 0) {
+			g.insert_edge(i, i - 1, -i);
+		}
+	}
+
+	auto const nodes = g.nodes();
+	CHECK(nodes.size() == n + 1);
+	CHECK(std::is_sorted(nodes.begin(), nodes.end()));
+
+	for (auto i = 1; i < n; ++i) {
+		CHECK(g.is_connected(i, INT_MAX));
+		CHECK(g.weights(i, i - 1) == std::vector<int>{-i});
+	}
+
+	// the edges are still iterated in {src, dst, weight} order
+	auto const edges = std::vector<gdwg::graph<int, int>::value_type>(g.begin(), g.end());
+	CHECK(edges.size() == 2 * n - 1);
+	CHECK(std::is_sorted(edges.begin(), edges.end(), [](auto const& a, auto const& b) {
+		return std::tie(a.from, a.to, a.weight) < std::tie(b.from, b.to, b.weight);
+	}));
+}
+
+TEST_CASE("looking up a missing node throws") {
+	auto g = gdwg::graph<int, int>{1, 2};
+	g.insert_edge(1, 2, 3);
+	CHECK_THROWS_AS(g.insert_edge(1, 4, 3), std::runtime_error);
+	CHECK_THROWS_AS(g.erase_edge(4, 2, 3), std::runtime_error);
+	CHECK_THROWS_AS(g.is_connected(1, 4), std::runtime_error);
+	CHECK_THROWS_AS(g.weights(4, 1), std::runtime_error);
+	CHECK_THROWS_AS(g.connections(4), std::runtime_error);
+	CHECK(g.is_connected(1, 2));
+	CHECK(g.erase_edge(1, 2, 3));
+	CHECK(!g.is_connected(1, 2));
+}
+
+TEST_CASE("insert_edges merges into the existing edges") {
+	using graph = gdwg::graph<int, int>;
+	auto g = graph{1, 2, 3};
+	g.insert_edge(1, 2, 5);
+	g.insert_edge(1, 3, 1);
+	g.insert_edge(3, 1, 2);
+
+	auto const edges = std::vector<graph::value_type>{
+	   {1, 3, 0},
+	   {1, 2, 5},
+	   {1, 3, 1},
+	   {2, 2, 4},
+	   {1, 3, 9},
+	   {2, 2, 4},
+	};
+	CHECK(g.insert_edges(edges) == 3);
+
+	auto expected = graph{1, 2, 3};
+	for (auto const& [from, to, weight] : {graph::value_type{1, 2, 5},
+	                                       graph::value_type{1, 3, 0},
+	                                       graph::value_type{1, 3, 1},
+	                                       graph::value_type{1, 3, 9},
+	                                       graph::value_type{2, 2, 4},
+	                                       graph::value_type{3, 1, 2}}) {
+		expected.insert_edge(from, to, weight);
+	}
+	CHECK(g == expected);
+}
+
+TEST_CASE("insert_edges with a missing node leaves the graph unchanged") {
+	using graph = gdwg::graph<int, int>;
+	auto g = graph{1, 2};
+	g.insert_edge(1, 2, 5);
+	auto const before = g;
+
+	auto const edges = std::vector<graph::value_type>{{1, 2, 7}, {2, 1, 8}, {1, 4, 9}};
+	CHECK_THROWS_AS(g.insert_edges(edges), std::runtime_error);
+	CHECK(g == before);
+	CHECK(g.weights(1, 2) == std::vector<int>{5});
+	CHECK(g.connections(2).empty());
+}
+
+// graph's iterator yields value_type prvalues, so nothing may point into them
+TEST_CASE("insert_edges copies the edges of another graph") {
+	using graph = gdwg::graph<std::string, std::string>;
+	auto a = graph{"a", "b", "c"};
+	a.insert_edge("a", "b", "a long weight that is not stored inline");
+	a.insert_edge("a", "c", "w1");
+	a.insert_edge("c", "a", "w2");
+	a.insert_edge("b", "b", "w3");
+
+	auto b = graph{"a", "b", "c"};
+	b.insert_edge("a", "c", "w1");
+	CHECK(b.insert_edges(a) == 3);
+	CHECK(b == a);
+	CHECK(b.insert_edges(a) == 0);
+}